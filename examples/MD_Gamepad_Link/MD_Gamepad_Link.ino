@@ -0,0 +1,90 @@
+// Radio link example for the MD_Gamepad library
+//
+// Sends the gamepad state over the nRF24L01 radio fitted to the shield using
+// the link layer in MD_Gamepad_Link.h. Payloads are sent without retransmits,
+// each repeating the changes from the previous payload, and the receiver can
+// change the link settings through the ACK payloads.
+//
+// The receiver runs MD_GamepadLinkRx with the same transport class.
+//
+// Dependencies
+// RF24 library at https://github.com/nRF24/RF24
+//
+#include <SPI.h>
+#include <RF24.h>
+#include <MD_Gamepad.h>
+#include <MD_Gamepad_Link.h>
+
+const uint8_t PIN_CE = 9;     // nRF24L01 socket on the shield
+const uint8_t PIN_CSN = 10;
+const uint8_t ADDRESS[6] = "GPAD1";
+
+const uint8_t REDUNDANCY = 1;   // previous payloads repeated
+const uint16_t KEEPALIVE = 500; // milliseconds
+const uint16_t INTERVAL = 4;    // milliseconds between payloads
+
+// Transport for the link layer using the RF24 library
+struct RF24Transport
+{
+  RF24 &radio;
+
+  bool send(const uint8_t *buf, uint8_t len) { return(radio.write(buf, len)); }
+
+  uint8_t readAck(uint8_t *buf)
+  {
+    if (!radio.isAckPayloadAvailable()) return(0);
+    uint8_t len = radio.getDynamicPayloadSize();
+    radio.read(buf, len);
+    return(len);
+  }
+
+  uint8_t receive(uint8_t *buf)
+  {
+    if (!radio.available()) return(0);
+    uint8_t len = radio.getDynamicPayloadSize();
+    radio.read(buf, len);
+    return(len);
+  }
+
+  void writeAck(const uint8_t *buf, uint8_t len) { radio.writeAckPayload(1, buf, len); }
+};
+
+RF24 radio(PIN_CE, PIN_CSN);
+RF24Transport transport = { radio };
+MD_GamepadLinkTx<RF24Transport> radioLink(transport);
+
+void setup(void)
+{
+  Serial.begin(57600);
+  gamepad.begin();
+  gamepad.setOutputRange(INT16_MAX);
+
+  if (!radio.begin())
+    Serial.println(F("Radio not found"));
+  radio.setRetries(0, 0);
+  radio.enableDynamicPayloads();
+  radio.enableAckPayload();
+  radio.openWritingPipe(ADDRESS);
+  radio.stopListening();
+
+  radioLink.begin(REDUNDANCY, KEEPALIVE, INTERVAL);
+}
+
+void loop(void)
+{
+  uint16_t now = millis();
+
+  gamepad.update();
+  radioLink.add(now, gamepad.getState(),
+    gamepad.getJoystickValue(MD_Gamepad::SW_X),
+    gamepad.getJoystickValue(MD_Gamepad::SW_Y));
+  radioLink.send(now);
+
+  if (radioLink.configChanged())
+  {
+    Serial.print(F("Link redundancy "));
+    Serial.print(radioLink.getConfig().redundancy);
+    Serial.print(F(" interval "));
+    Serial.println(radioLink.getConfig().interval);
+  }
+}
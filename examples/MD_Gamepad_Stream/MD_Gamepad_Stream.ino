@@ -0,0 +1,40 @@
+// Binary state streaming example for the MD_Gamepad library
+//
+// Sends the gamepad state as compact binary frames (see MD_Gamepad_Stream.h)
+// instead of text. Only the fields that change are sent, with a full frame
+// at least every second as a keepalive. A frame is only encoded
+// when the serial transmit buffer has room for it, so the loop never blocks.
+//
+// The frames can be decoded on a Linux host with the tools in extras/host.
+//
+#include <MD_Gamepad.h>
+#include <MD_Gamepad_Stream.h>
+
+const uint32_t BAUD_RATE = 115200;
+const uint16_t KEEPALIVE = 1000;  // milliseconds
+
+MD_GamepadStream stream;
+
+void setup(void)
+{
+  Serial.begin(BAUD_RATE);
+  gamepad.begin();
+  gamepad.setReadDelay(5);
+  gamepad.setOutputRange(INT16_MAX);
+  stream.begin(KEEPALIVE);
+}
+
+void loop(void)
+{
+  gamepad.update();
+
+  if (Serial.availableForWrite() >= MD_GamepadStream::FRAME_MAX)
+  {
+    uint8_t n = stream.encode(millis(), gamepad.getState(),
+      gamepad.getJoystickValue(MD_Gamepad::SW_X),
+      gamepad.getJoystickValue(MD_Gamepad::SW_Y));
+
+    if (n != 0)
+      Serial.write(stream.data(), n);
+  }
+}
@@ -11,9 +11,12 @@ void setup(void)
 
 void loop(void)
 {
-  MD_Gamepad::switch_t sw = gamepad.getSwitch();
+  MD_Gamepad::switch_t sw;
   int16_t z;
 
+  gamepad.update();
+  sw = gamepad.getSwitch();
+
   // Process the digital switches
   if (sw != MD_Gamepad::SW_NONE)
   {
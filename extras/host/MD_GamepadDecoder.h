@@ -0,0 +1,345 @@
+/*
+MD_Gamepad - Library to encapsulate a Gamepad/Joystick Shield.
+
+See main header file for information.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <MD_Gamepad_Stream.h>
+
+/**
+ * \file
+ * \brief Linux host decoder for the MD_Gamepad binary state stream
+ *
+ * MD_GamepadDecoder reads the stream written by MD_GamepadStream from a file
+ * descriptor (serial port, pty, pipe or file) and decodes the frames in place,
+ * without copying them out of its receive buffer. MD_GamepadStreamStats collects
+ * the frame rate, sequence gaps and the jitter and latency histograms.
+ */
+
+/**
+ * Zero copy stream decoder.
+ *
+ * The receive buffer is a ring mapped twice into consecutive virtual memory, so
+ * bytes past the end of the ring appear again at its start. Data is read from the
+ * file descriptor straight into the ring and every frame is contiguous in memory
+ * wherever it starts, so it can be COBS decoded in place.
+ */
+class MD_GamepadDecoder
+{
+  public:
+  static const size_t RING_SIZE = 1 << 16;   ///< receive ring size, a multiple of the page size
+
+  /**
+   * Decoder error counters.
+   */
+  struct errors_t
+  {
+    uint32_t corrupt;   ///< frames that failed the COBS, length or CRC check
+    uint32_t overrun;   ///< frames too long to be valid, discarded
+  };
+
+  MD_GamepadDecoder(void) : _ring(nullptr), _head(0), _tail(0), _scan(0), _errors{0, 0} {}
+  ~MD_GamepadDecoder(void) { end(); }
+
+  /**
+   * Create the receive ring.
+   *
+   * \return true if the ring was mapped.
+   */
+  bool begin(void)
+  {
+    int fd = memfd_create("md_gamepad_ring", 0);
+    uint8_t *p;
+
+    if (fd < 0)
+      return(false);
+    if (ftruncate(fd, RING_SIZE) != 0)
+    {
+      close(fd);
+      return(false);
+    }
+
+    // reserve twice the size, then map the same memory over both halves
+    p = (uint8_t *)mmap(nullptr, 2 * RING_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p != MAP_FAILED &&
+       (mmap(p, RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(p + RING_SIZE, RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED))
+    {
+      munmap(p, 2 * RING_SIZE);
+      p = (uint8_t *)MAP_FAILED;
+    }
+    close(fd);
+
+    if (p == MAP_FAILED)
+      return(false);
+    _ring = p;
+    _head = _tail = _scan = 0;
+
+    return(true);
+  }
+
+  /**
+   * Release the receive ring.
+   */
+  void end(void)
+  {
+    if (_ring != nullptr)
+      munmap(_ring, 2 * RING_SIZE);
+    _ring = nullptr;
+  }
+
+  /**
+   * Read the bytes available from a file descriptor into the ring.
+   *
+   * \param fd the file descriptor.
+   * \return the number of bytes read, 0 at end of file or -1 on error (see read()).
+   */
+  ssize_t fill(int fd)
+  {
+    size_t space = RING_SIZE - (size_t)(_head - _tail);
+    ssize_t n;
+
+    if (space == 0)
+    {
+      // no delimiter in a full ring, so it cannot hold a valid frame
+      _errors.overrun++;
+      _tail = _scan = _head;
+      space = RING_SIZE;
+    }
+
+    n = read(fd, _ring + (_head % RING_SIZE), space);
+    if (n > 0)
+      _head += n;
+
+    return(n);
+  }
+
+  /**
+   * Decode the next frame from the ring.
+   *
+   * \param f the frame data to update with the fields in the frame.
+   * \return true if a frame was decoded, false if no complete frame is waiting.
+   */
+  bool next(MD_GamepadStream::frame_t &f)
+  {
+    while (_scan != _head)
+    {
+      if (_ring[_scan++ % RING_SIZE] != 0)
+        continue;
+
+      // a frame from the tail to the delimiter, contiguous in the mirrored ring
+      uint8_t *frame = _ring + (_tail % RING_SIZE);
+      size_t len = _scan - 1 - _tail;
+
+      _tail = _scan;
+      if (len == 0)
+        continue;   // empty frame, used to resynchronize
+      if (len > MD_GamepadStream::FRAME_MAX)
+      {
+        _errors.overrun++;
+        continue;
+      }
+      if (MD_GamepadStream::decode(frame, len, f))
+        return(true);
+      _errors.corrupt++;
+    }
+
+    return(false);
+  }
+
+  /**
+   * Get the decoder error counters.
+   *
+   * \return the error counters.
+   */
+  inline const errors_t &errors(void) const { return(_errors); }
+
+  private:
+  uint8_t *_ring;     ///< the receive ring, mapped twice
+  uint64_t _head;     ///< total bytes written to the ring
+  uint64_t _tail;     ///< start of the frame being received
+  uint64_t _scan;     ///< next byte to check for a delimiter
+  errors_t _errors;   ///< error counters
+};
+
+/**
+ * Histogram with power of 2 bucket widths.
+ *
+ * Bucket 0 counts 0, bucket n counts values from 2^(n-1) to 2^n - 1, and the
+ * last bucket counts all larger values.
+ */
+struct MD_GamepadHistogram
+{
+  static const uint8_t BUCKETS = 24;   ///< number of buckets
+
+  uint64_t count[BUCKETS];   ///< the count in each bucket
+  uint64_t total;            ///< the number of values
+  uint64_t sum;              ///< the sum of the values
+  uint64_t max;              ///< the largest value
+
+  /**
+   * Clear the histogram.
+   */
+  void clear(void) { memset(this, 0, sizeof(*this)); }
+
+  /**
+   * Add a value.
+   *
+   * \param v the value.
+   */
+  void add(uint64_t v)
+  {
+    uint8_t b = 0;
+
+    while (b < BUCKETS - 1 && (v >> b) != 0) b++;
+    count[b]++;
+    total++;
+    sum += v;
+    if (v > max) max = v;
+  }
+
+  /**
+   * Get the upper bound of a bucket.
+   *
+   * \param b the bucket.
+   * \return the largest value counted in the bucket.
+   */
+  static uint64_t upper(uint8_t b) { return(b == 0 ? 0 : (1ULL << b) - 1); }
+
+  /**
+   * Estimate a percentile.
+   *
+   * \param p the percentile, 0 to 100.
+   * \return the upper bound of the bucket holding the percentile.
+   */
+  uint64_t percentile(uint8_t p) const
+  {
+    uint64_t target = (total * p + 99) / 100, n = 0;
+
+    for (uint8_t b = 0; b < BUCKETS; b++)
+      if ((n += count[b]) >= target && n != 0)
+        return(b == BUCKETS - 1 ? max : upper(b));
+
+    return(0);
+  }
+};
+
+/**
+ * Stream statistics.
+ *
+ * Each frame is added with the host time it was received. The device timestamps
+ * are extended from 16 bits using the previous frame.
+ *
+ * - Jitter is the difference between the time between frames measured by the host
+ *   and by the device, so it shows the delays added by the link and the host.
+ * - Latency is the host receive time minus the device sample time. The device and
+ *   host clocks are not synchronized, so it is measured from the smallest
+ *   difference seen, taken as the fixed part of the latency. The histogram shows
+ *   the variable latency added to the fastest frame.
+ */
+class MD_GamepadStreamStats
+{
+  public:
+  MD_GamepadStreamStats(void) { clear(); }
+
+  /**
+   * Clear the statistics.
+   */
+  void clear(void)
+  {
+    frames = keepalives = lost = gaps = duplicates = 0;
+    jitter.clear();
+    latency.clear();
+    _first = true;
+    _hostUs = _firstHostUs = 0;
+  }
+
+  /**
+   * Add a frame.
+   *
+   * \param f      the decoded frame.
+   * \param hostUs the host time the frame was received in microseconds, 0 if not known.
+   */
+  void add(const MD_GamepadStream::frame_t &f, uint64_t hostUs)
+  {
+    frames++;
+    if (f.flags & MD_GamepadStream::F_FULL)
+      keepalives++;
+
+    if (_first)
+    {
+      _first = false;
+      _devMs = _firstDevMs = f.time;
+      _minOffset = INT64_MAX;
+      _firstHostUs = hostUs;
+    }
+    else
+    {
+      uint8_t d = f.seq - _seq;
+
+      if (d == 0)
+        duplicates++;
+      else if (d != 1)
+      {
+        gaps++;
+        lost += d - 1;
+      }
+      _devMs += (uint16_t)(f.time - (uint16_t)_devMs);
+    }
+
+    if (hostUs != 0)
+    {
+      int64_t offset = (int64_t)hostUs - (int64_t)(_devMs * 1000);
+
+      if (frames > 1)
+      {
+        int64_t j = ((int64_t)hostUs - (int64_t)_hostUs) - (int64_t)((_devMs - _prevDevMs) * 1000);
+
+        jitter.add(j < 0 ? -j : j);
+      }
+      if (offset < _minOffset)
+        _minOffset = offset;
+      latency.add(offset - _minOffset);
+      _hostUs = hostUs;
+    }
+    _seq = f.seq;
+    _prevDevMs = _devMs;
+  }
+
+  /**
+   * Get the frame rate.
+   *
+   * \return the frames per second of host time, or of device time if the host time is not known.
+   */
+  double rate(void) const
+  {
+    double s = (_hostUs != 0 ? (_hostUs - _firstHostUs) / 1e6 : (_devMs - _firstDevMs) / 1e3);
+
+    return(s > 0 ? (frames - 1) / s : 0);
+  }
+
+  uint64_t frames;        ///< frames received
+  uint64_t keepalives;    ///< full (keepalive) frames received
+  uint64_t lost;          ///< frames missing from the sequence numbers
+  uint64_t gaps;          ///< breaks in the sequence numbers
+  uint64_t duplicates;    ///< frames repeating the sequence number of the frame before
+  MD_GamepadHistogram jitter;   ///< inter-frame jitter in microseconds
+  MD_GamepadHistogram latency;  ///< latency above the minimum in microseconds
+
+  private:
+  bool     _first;        ///< true until the first frame is added
+  uint8_t  _seq;          ///< sequence number of the last frame
+  uint64_t _devMs;        ///< extended device time of the last frame
+  uint64_t _prevDevMs;    ///< extended device time of the frame before
+  uint64_t _hostUs;       ///< host time of the last frame
+  uint64_t _firstHostUs;  ///< host time of the first frame
+  uint64_t _firstDevMs;   ///< extended device time of the first frame
+  int64_t  _minOffset;    ///< smallest host minus device time seen
+};
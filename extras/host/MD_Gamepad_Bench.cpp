@@ -0,0 +1,184 @@
+// Host microbenchmark for the MD_Gamepad library input hot paths
+//
+// Runs each library method repeatedly against the simulated hardware in
+// MD_Gamepad_Host.h and reports:
+// - the host wall time per call and calls per second.
+// - the hardware accesses per call and the modeled target cycles they cost,
+//   using the cycle costs in MD_GamepadHAL::cost.
+//
+// The modeled cycles only include the hardware accesses, not the library's own
+// code, but these dominate the cost on the target and are what changes when
+// the scan loop or sampling scheme is changed.
+//
+// Build and run from the library folder:
+//   g++ -std=c++11 -O2 -Isrc -o gamepad_bench extras/host/MD_Gamepad_Bench.cpp
+//   ./gamepad_bench [iterations]
+//
+// Add -DGAMEPAD_PORT_IO=1 or -DGAMEPAD_ADC_ISR=1 to benchmark those options.
+// With GAMEPAD_ADC_ISR the oversampling cases complete the background
+// conversions for a new value of both axes, 2 * 4^n calls of the ADC interrupt
+// handler, before each update(), so the cost per output sample includes the
+// interrupts.
+//
+#include <stdio.h>
+#include <chrono>
+#include <MD_Gamepad.h>
+
+// Volatile sink so the compiler cannot optimize away the calls being measured
+volatile int32_t sink;
+
+// One benchmark case
+struct bench_t
+{
+  const char *name;       // name of the case
+  void (*setup)(void);    // called once before timing
+  void (*run)(void);      // the operation being measured
+};
+
+// Set up the hardware with a switch pressed and the joystick deflected
+void setupPressed(void)
+{
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_K, true);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 800);
+}
+
+// Set up the hardware with no switches pressed and the joystick centered
+void setupIdle(void)
+{
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_K, false);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 512);
+}
+
+// Set the channel delays so that every update() samples everything
+void setupNoDelay(void)
+{
+  setupPressed();
+  gamepad.setReadDelay(0);
+  gamepad.setDebounceDelay(0);
+}
+
+// Sample the axes on every update() with oversampling
+uint8_t oversample;
+
+void setupOversample(uint8_t n)
+{
+  setupPressed();
+  gamepad.setReadDelay(0);
+  gamepad.setOversample(n);
+  oversample = n;
+}
+
+void setupOversample0(void) { setupOversample(0); }
+void setupOversample1(void) { setupOversample(1); }
+void setupOversample2(void) { setupOversample(2); }
+void setupOversample3(void) { setupOversample(3); }
+#if GAMEPAD_ADC_ISR
+void setupOversample4(void) { setupOversample(4); }
+void setupOversample6(void) { setupOversample(6); }
+#endif
+
+// Advance the clock 1ms per call, as if update() was called from a 1kHz loop
+void runUpdate(void) { MD_GamepadHAL::advance(1); sink = gamepad.update(); }
+
+// Update with a new oversampled value for each axis
+void runUpdateSample(void)
+{
+#if GAMEPAD_ADC_ISR
+  for (uint16_t k = 2 << (2 * oversample); k > 0; k--)
+    MD_GamepadHAL_ADC::convert(ADC_vect);
+#endif
+  runUpdate();
+}
+
+// Filter kernels on a noisy input, independent of the hardware
+MD_GamepadFilterEMA<3> filterEMA;
+MD_GamepadFilterMedian3 filterMedian3;
+MD_GamepadFilterOneEuro<> filterOneEuro;
+int16_t filterInput;
+
+void runFilterEMA(void) { sink = filterEMA.filter(filterInput++ & 0x3f, 1); }
+void runFilterMedian3(void) { sink = filterMedian3.filter(filterInput++ & 0x3f, 1); }
+void runFilterOneEuro(void) { sink = filterOneEuro.filter(filterInput++ & 0x3f, 1); }
+
+// Radial deadzone stage on a moving input, independent of the hardware
+MD_GamepadStick stick;
+
+void setupStick(void) { stick.begin(32767); stick.set(10, 95, 5); }
+void runStick(void) { int16_t x = filterInput++, y = 20000 - x; stick.apply(x, y); sink = x + y; }
+void runAtan2(void) { int16_t x = filterInput++; sink = MD_GamepadStick::atan2(20000 - x, x); }
+
+// Response curve lookup, independent of the hardware
+GAMEPAD_CURVE(curveBench, curveExpo, 40, 100);
+MD_GamepadCurve curve;
+
+void setupCurve(void) { curve.begin(32767); curve.setTable(curveBench); }
+void runCurve(void) { sink = curve.apply(filterInput++); }
+
+void runGetSwitch(void) { sink = gamepad.getSwitch(); }
+void runAnyKey(void) { sink = gamepad.anyKey(); }
+void runGetState(void) { sink = gamepad.getState(); }
+void runGetValue(void) { sink = gamepad.getJoystickValue(MD_Gamepad::SW_X); }
+void runGetDirection(void) { sink = gamepad.getJoystickDirection(MD_Gamepad::SW_X); }
+
+const bench_t bench[] =
+{
+  { "update() 1kHz, idle",           setupIdle,         runUpdate },
+  { "update() 1kHz, pressed",        setupPressed,      runUpdate },
+  { "update() all channels due",     setupNoDelay,      runUpdate },
+  { "update() axes, oversample 0",   setupOversample0,  runUpdateSample },
+  { "update() axes, oversample 1",   setupOversample1,  runUpdateSample },
+  { "update() axes, oversample 2",   setupOversample2,  runUpdateSample },
+  { "update() axes, oversample 3",   setupOversample3,  runUpdateSample },
+#if GAMEPAD_ADC_ISR
+  { "update() axes, oversample 4",   setupOversample4,  runUpdateSample },
+  { "update() axes, oversample 6",   setupOversample6,  runUpdateSample },
+#endif
+  { "getSwitch()",                   setupPressed,      runGetSwitch },
+  { "anyKey()",                      setupPressed,      runAnyKey },
+  { "getState()",                    setupPressed,      runGetState },
+  { "getJoystickValue()",            setupPressed,      runGetValue },
+  { "getJoystickDirection()",        setupPressed,      runGetDirection },
+  { "MD_GamepadFilterEMA<3>",        setupIdle,         runFilterEMA },
+  { "MD_GamepadFilterMedian3",       setupIdle,         runFilterMedian3 },
+  { "MD_GamepadFilterOneEuro<>",     setupIdle,         runFilterOneEuro },
+  { "MD_GamepadStick::apply()",      setupStick,        runStick },
+  { "MD_GamepadStick::atan2()",      setupIdle,         runAtan2 },
+  { "MD_GamepadCurve::apply()",      setupCurve,        runCurve },
+};
+
+int main(int argc, char *argv[])
+{
+  uint32_t iterations = (argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000);
+
+  printf("MD_Gamepad host benchmark, %u iterations, target modeled at %u MHz\n",
+    iterations, MD_GamepadHAL::clockHz / 1000000);
+  printf("%-30s %10s %12s %8s %8s %8s %8s %10s %10s\n",
+    "Case", "ns/call", "calls/s", "dRead", "aRead", "port", "isr", "cyc/call", "us/call");
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(bench); i++)
+  {
+    MD_GamepadHAL::reset();
+    gamepad.begin();
+    bench[i].setup();
+    gamepad.update();
+    MD_GamepadHAL::clearCount();
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < iterations; n++)
+      bench[i].run();
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    double cycles = (double)MD_GamepadHAL::count.cycles / iterations;
+
+    printf("%-30s %10.2f %12.0f %8.3f %8.3f %8.3f %8.1f %10.1f %10.2f\n", bench[i].name,
+      ns, 1e9 / ns,
+      (double)MD_GamepadHAL::count.digitalRead / iterations,
+      (double)MD_GamepadHAL::count.analogRead / iterations,
+      (double)MD_GamepadHAL::count.portRead / iterations,
+      (double)MD_GamepadHAL::count.isr / iterations,
+      cycles, cycles * 1e6 / MD_GamepadHAL::clockHz);
+  }
+
+  return(0);
+}
@@ -0,0 +1,233 @@
+// Host decoder and stream analyzer for the MD_Gamepad binary state stream
+//
+// Reads the frames sent by the MD_Gamepad_Stream example (see MD_Gamepad_Stream.h)
+// from a serial port, a pty, a pipe or a file, and reports:
+// - the frame rate, keepalive frames, the frames lost from gaps in the
+//   sequence numbers and the frames received twice.
+// - corrupt frames rejected by the COBS, length or CRC checks.
+// - histograms of the inter-frame jitter and of the latency above the minimum
+//   (see MD_GamepadStreamStats), when reading from a live device.
+//
+// Build and run from the library folder:
+//   g++ -std=c++11 -O2 -Isrc -Iextras/host -o gamepad_decode extras/host/MD_Gamepad_Decode.cpp
+//   ./gamepad_decode [-b baud] [-t seconds] [-v] <device | file | ->
+//
+// -b sets the serial port speed (default 115200), -t stops after a time and
+// -v prints every frame. A report is printed every 5 seconds when reading a
+// live device and at the end.
+//
+// To test without hardware, run the stream simulator on a pty and decode it:
+//   ./gamepad_sim -p &      (prints the pty name, eg /dev/pts/3)
+//   ./gamepad_decode /dev/pts/3
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <MD_GamepadDecoder.h>
+
+static volatile sig_atomic_t stop = 0;
+
+static void onSignal(int) { stop = 1; }
+
+// Monotonic host time in microseconds
+static uint64_t nowUs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+// Map a baud rate to the termios speed constant
+static speed_t baudCode(long baud)
+{
+  switch (baud)
+  {
+  case 9600: return(B9600);
+  case 19200: return(B19200);
+  case 38400: return(B38400);
+  case 57600: return(B57600);
+  case 115200: return(B115200);
+  case 230400: return(B230400);
+  case 460800: return(B460800);
+  case 500000: return(B500000);
+  case 1000000: return(B1000000);
+  case 2000000: return(B2000000);
+  default: return(0);
+  }
+}
+
+// Set a terminal (serial port or pty) to raw mode at the baud rate
+static bool setRaw(int fd, long baud)
+{
+  struct termios t;
+  speed_t s = baudCode(baud);
+
+  if (s == 0)
+  {
+    fprintf(stderr, "Unsupported baud rate %ld\n", baud);
+    return(false);
+  }
+  if (tcgetattr(fd, &t) != 0)
+    return(false);
+  cfmakeraw(&t);
+  t.c_cflag |= CLOCAL | CREAD;
+  t.c_cc[VMIN] = 1;
+  t.c_cc[VTIME] = 0;
+  cfsetispeed(&t, s);
+  cfsetospeed(&t, s);
+
+  return(tcsetattr(fd, TCSANOW, &t) == 0);
+}
+
+// Print one histogram, skipping empty buckets
+static void printHistogram(const char *name, const MD_GamepadHistogram &h)
+{
+  if (h.total == 0)
+    return;
+
+  printf("%s (us): mean %.0f p50 <=%llu p99 <=%llu max %llu\n", name,
+    (double)h.sum / h.total, (unsigned long long)h.percentile(50),
+    (unsigned long long)h.percentile(99), (unsigned long long)h.max);
+  for (uint8_t b = 0; b < MD_GamepadHistogram::BUCKETS; b++)
+  {
+    if (h.count[b] == 0)
+      continue;
+
+    int bar = (int)(50 * h.count[b] / h.total);
+
+    printf("  <= %8llu %10llu %5.1f%% ", (unsigned long long)MD_GamepadHistogram::upper(b),
+      (unsigned long long)h.count[b], 100.0 * h.count[b] / h.total);
+    while (bar--) putchar('#');
+    putchar('\n');
+  }
+}
+
+// Print the statistics report
+static void report(const MD_GamepadStreamStats &s, const MD_GamepadDecoder &d)
+{
+  printf("\nFrames %llu (%.1f/s), keepalives %llu, lost %llu in %llu gaps, duplicates %llu, corrupt %u, overrun %u\n",
+    (unsigned long long)s.frames, s.rate(), (unsigned long long)s.keepalives,
+    (unsigned long long)s.lost, (unsigned long long)s.gaps, (unsigned long long)s.duplicates,
+    d.errors().corrupt, d.errors().overrun);
+  printHistogram("Jitter", s.jitter);
+  printHistogram("Latency above minimum", s.latency);
+  fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+  long baud = 115200;
+  double seconds = 0;
+  bool verbose = false;
+  int opt, fd;
+  bool live;
+  MD_GamepadDecoder decoder;
+  MD_GamepadStreamStats stats;
+  MD_GamepadStream::frame_t f;
+
+  while ((opt = getopt(argc, argv, "b:t:v")) != -1)
+  {
+    switch (opt)
+    {
+    case 'b': baud = strtol(optarg, nullptr, 10); break;
+    case 't': seconds = strtod(optarg, nullptr); break;
+    case 'v': verbose = true; break;
+    default:
+      fprintf(stderr, "Usage: %s [-b baud] [-t seconds] [-v] <device | file | ->\n", argv[0]);
+      return(1);
+    }
+  }
+  if (optind >= argc)
+  {
+    fprintf(stderr, "Usage: %s [-b baud] [-t seconds] [-v] <device | file | ->\n", argv[0]);
+    return(1);
+  }
+
+  fd = (strcmp(argv[optind], "-") == 0 ? STDIN_FILENO : open(argv[optind], O_RDONLY | O_NOCTTY));
+  if (fd < 0)
+  {
+    fprintf(stderr, "Cannot open %s: %s\n", argv[optind], strerror(errno));
+    return(1);
+  }
+
+  // terminals and pipes are live streams timed by the host, files are not
+  live = isatty(fd);
+  if (live && !setRaw(fd, baud))
+  {
+    fprintf(stderr, "Cannot configure %s: %s\n", argv[optind], strerror(errno));
+    return(1);
+  }
+  if (!live)
+  {
+    struct stat st;
+
+    live = (fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode));
+  }
+
+  if (!decoder.begin())
+  {
+    fprintf(stderr, "Cannot create the receive ring: %s\n", strerror(errno));
+    return(1);
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  memset(&f, 0, sizeof(f));
+
+  uint64_t start = nowUs(), lastReport = start;
+
+  while (!stop)
+  {
+    struct pollfd p = { fd, POLLIN, 0 };
+    uint64_t t;
+
+    if (poll(&p, 1, 100) < 0)
+    {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    t = nowUs();
+    if (p.revents & (POLLIN | POLLHUP | POLLERR))
+    {
+      ssize_t n = decoder.fill(fd);
+
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;   // end of file, or the device went away
+
+      t = nowUs();
+      while (decoder.next(f))
+      {
+        stats.add(f, live ? t : 0);
+        if (verbose)
+          printf("seq %3u time %5u %c%c%c%c sw %04x x %6d y %6d\n", f.seq, f.time,
+            (f.flags & MD_GamepadStream::F_FULL) ? 'F' : '-', (f.flags & MD_GamepadStream::F_SW) ? 'S' : '-',
+            (f.flags & MD_GamepadStream::F_X) ? 'X' : '-', (f.flags & MD_GamepadStream::F_Y) ? 'Y' : '-',
+            f.sw, f.x, f.y);
+      }
+    }
+
+    if (seconds > 0 && t - start >= seconds * 1e6)
+      break;
+    if (live && t - lastReport >= 5000000)
+    {
+      report(stats, decoder);
+      lastReport = t;
+    }
+  }
+
+  report(stats, decoder);
+  if (fd != STDIN_FILENO)
+    close(fd);
+
+  return(0);
+}
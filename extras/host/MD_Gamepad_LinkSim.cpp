@@ -0,0 +1,333 @@
+// Lossy radio simulation for the MD_Gamepad link layer
+//
+// Runs the link transmitter and receiver (see MD_Gamepad_Link.h) against a
+// simulated radio that loses payloads and ACKs in bursts (a Gilbert-Elliott
+// model), for each redundancy setting, and reports:
+// - the payloads sent and lost, and the records lost after the redundant copies,
+//   in all and in the first half with the redundancy of the run. The records
+//   lost in the first half must fall as the redundancy rises.
+// - the latency from a state change to the receiver applying it.
+// - the number of updates where the receiver reported itself synchronized but
+//   its state was not the state sent, which must be 0.
+//
+// The receiver also changes the link configuration halfway through each run, to
+// check the configuration sent in the ACK payloads reaches the transmitter. The
+// payloads sent are checked against the configuration in use before and after
+// the change: the number of payloads each record is sent in (the redundancy),
+// the longest time between full records (the keepalive) and the shortest time
+// between payloads (the interval).
+//
+// The program returns 1 if a check fails, so it can be used as a test.
+//
+// Build and run from the library folder:
+//   g++ -std=c++11 -O2 -Isrc -o gamepad_linksim extras/host/MD_Gamepad_LinkSim.cpp
+//   ./gamepad_linksim [loss%] [seconds]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <MD_Gamepad_Link.h>
+
+// Simulated radio with both ends of the link. Payloads are delivered at once,
+// into a 3 payload receive FIFO as in the nRF24L01.
+struct SimRadio
+{
+  static const uint8_t FIFO = 3;
+
+  // What the transmitter sent since the configuration was last changed
+  struct check_t
+  {
+    uint8_t  copiesMax;   ///< most payloads a record was sent in
+    uint16_t fullGapMax;  ///< longest time between full records
+    uint16_t sendGapMin;  ///< shortest time between payloads
+  };
+
+  double   lossGood, lossBad;   // loss probability in the good and bad (burst) states
+  double   toBad, toGood;       // probability of changing state for each payload
+  bool     bad;                 // current channel state
+  uint8_t  fifo[FIFO][MD_GamepadLink::PAYLOAD_MAX];
+  uint8_t  fifoLen[FIFO];
+  uint8_t  fifoCount;
+  uint8_t  ack[MD_GamepadLink::PAYLOAD_MAX], ackLen;   // ACK payload loaded by the receiver
+  uint8_t  rxAck[MD_GamepadLink::PAYLOAD_MAX], rxAckLen;  // ACK payload received by the transmitter
+  uint32_t sent, lost;
+  uint16_t now;                 // time of the payload being sent
+  check_t  check;
+  uint8_t  phase;               // configuration in use, incremented by newPhase()
+  uint8_t  copies[256], copiesPhase[256];  // for each sequence number
+  uint8_t  end;                 // sequence number after the last record sent
+  uint16_t lastSend, lastFull;
+  bool     haveSend, haveFull;
+
+  void begin(double loss)
+  {
+    // bursts of 3 payloads on average, with the average loss rate requested
+    toGood = 1.0 / 3;
+    lossBad = 0.75;
+    lossGood = loss / 10;
+    toBad = (loss > lossGood ? toGood * (loss - lossGood) / (lossBad - loss) : 0);
+    bad = false;
+    fifoCount = ackLen = rxAckLen = 0;
+    sent = lost = 0;
+    now = end = 0;
+    phase = 0;
+    haveSend = false;
+    memset(copies, 0, sizeof(copies));
+    newPhase();
+  }
+
+  // Start checking the payloads against a new configuration
+  void newPhase(void)
+  {
+    phase++;
+    check.copiesMax = check.fullGapMax = 0;
+    check.sendGapMin = UINT16_MAX;
+    haveFull = false;
+  }
+
+  // Check a payload sent, lost or not
+  void checkPayload(const uint8_t *buf, uint8_t len)
+  {
+    uint8_t seq = buf[0], n = MD_GamepadLink::HEADER;
+    uint16_t t0 = buf[1] | (buf[2] << 8);
+
+    if (haveSend && (uint16_t)(now - lastSend) < check.sendGapMin)
+      check.sendGapMin = now - lastSend;
+    lastSend = now;
+    haveSend = true;
+
+    for (; n < len; seq++)
+    {
+      uint8_t flags = buf[n];
+      uint16_t t = t0 + buf[n + 1];
+      uint8_t last = seq + MD_GamepadLink::recordSpan(flags);
+
+      n += MD_GamepadLink::recordSize(flags);
+      if ((uint8_t)(last - end) < 0x80 && (flags & MD_GamepadStream::F_FULL))
+      {
+        // first time a full record is sent
+        if (haveFull && (uint16_t)(t - lastFull) > check.fullGapMax)
+          check.fullGapMax = t - lastFull;
+        lastFull = t;
+        haveFull = true;
+      }
+
+      // count the copies of each record merged into this one
+      for (;; seq++)
+      {
+        if ((uint8_t)(seq - end) < 0x80)
+        {
+          // first time the record is sent
+          copies[seq] = 0;
+          copiesPhase[seq] = phase;
+          end = seq + 1;
+        }
+        if (++copies[seq] > check.copiesMax && copiesPhase[seq] == phase)
+          check.copiesMax = copies[seq];
+        if (seq == last)
+          break;
+      }
+    }
+  }
+
+  bool chance(double p) { return(rand() < p * RAND_MAX); }
+
+  bool lose(void)
+  {
+    bad = (bad ? !chance(toGood) : chance(toBad));
+    return(chance(bad ? lossBad : lossGood));
+  }
+
+  // Transmitter side
+  bool send(const uint8_t *buf, uint8_t len)
+  {
+    // the ACK is lost at the same rate as the payload
+    bool payloadLost = lose(), ackLost = lose();
+
+    checkPayload(buf, len);
+    sent++;
+    rxAckLen = 0;
+    if (payloadLost || fifoCount == FIFO)
+    {
+      lost++;
+      return(false);
+    }
+    memcpy(fifo[fifoCount], buf, len);
+    fifoLen[fifoCount++] = len;
+
+    if (ackLost)
+      return(false);
+    memcpy(rxAck, ack, ackLen);
+    rxAckLen = ackLen;
+    ackLen = 0;
+    return(true);
+  }
+
+  uint8_t readAck(uint8_t *buf)
+  {
+    uint8_t len = rxAckLen;
+
+    memcpy(buf, rxAck, len);
+    rxAckLen = 0;
+    return(len);
+  }
+
+  // Receiver side
+  uint8_t receive(uint8_t *buf)
+  {
+    uint8_t len;
+
+    if (fifoCount == 0)
+      return(0);
+    len = fifoLen[0];
+    memcpy(buf, fifo[0], len);
+    fifoCount--;
+    memmove(fifo[0], fifo[1], fifoCount * sizeof(fifo[0]));
+    memmove(fifoLen, fifoLen + 1, fifoCount);
+    return(len);
+  }
+
+  void writeAck(const uint8_t *buf, uint8_t len)
+  {
+    memcpy(ack, buf, len);
+    ackLen = len;
+  }
+};
+
+// Simulated gamepad state at a time in milliseconds: the joystick moving in a
+// circle, changing every millisecond, and stopping, and the switches pressed in
+// turn, some briefly.
+static void gamepadState(uint32_t t, uint16_t &sw, int16_t &x, int16_t &y)
+{
+  double a = 2 * M_PI * t / 1500.0;
+
+  x = y = 0;
+  if ((t / 3000) % 2 == 0)
+  {
+    x = (int16_t)(20000 * cos(a));
+    y = (int16_t)(20000 * sin(a));
+  }
+  sw = ((t % 700) < ((t / 700) % 3 == 0 ? 30 : 200)) ? (1 << ((t / 700) % 7)) : 0;
+}
+
+// Check the payloads sent used the configuration
+static bool checkConfig(const SimRadio::check_t &c, uint8_t redundancy, uint16_t keepalive, uint16_t interval)
+{
+  return(c.copiesMax == redundancy + 1 && c.sendGapMin >= interval &&
+    c.fullGapMax >= keepalive && c.fullGapMax <= keepalive + interval);
+}
+
+// Run one simulation and print a line of results, returning true if all the checks pass,
+// with the records lost before the configuration change in lost
+static bool run(double loss, uint8_t redundancy, uint32_t ms, uint32_t &lost)
+{
+  const uint16_t INTERVAL = 4, KEEPALIVE = 250;
+  const uint16_t NEW_INTERVAL = 8, NEW_KEEPALIVE = 100;
+  const uint8_t newRedundancy = (redundancy + 1) % (LINK_REDUNDANCY_MAX + 1);
+  SimRadio radio;
+  MD_GamepadLinkTx<SimRadio> tx(radio);
+  MD_GamepadLinkRx<SimRadio> rx(radio);
+  MD_GamepadStream::frame_t f;
+  uint64_t latencySum = 0;
+  uint32_t latencyMax = 0, latencyCount = 0, wrong = 0, unsynced = 0;
+  bool configOk = false, changed = false;
+
+  srand(1);
+  radio.begin(loss / 100);
+  tx.begin(redundancy, KEEPALIVE, INTERVAL);
+  rx.begin();
+
+  for (uint32_t t = 0; t < ms; t++)
+  {
+    uint16_t sw;
+    int16_t x, y;
+
+    gamepadState(t, sw, x, y);
+    tx.add(t, sw, x, y);
+    radio.now = t;
+    tx.send(t);
+    rx.receive();
+
+    while (rx.read(f))
+    {
+      uint32_t late = (uint16_t)(t - f.time);
+
+      latencySum += late;
+      latencyCount++;
+      if (late > latencyMax) latencyMax = late;
+    }
+
+    // check the latest state against the state sent at its time
+    if (rx.isSynced())
+    {
+      const MD_GamepadStream::frame_t &s = rx.getState();
+      uint16_t sw0;
+      int16_t x0, y0;
+
+      gamepadState(t - (uint16_t)(t - s.time), sw0, x0, y0);
+      if (s.sw != sw0 || s.x != x0 || s.y != y0)
+        wrong++;
+    }
+    else
+      unsynced++;
+
+    // change the configuration halfway, checking the payloads sent before the
+    // change used the initial configuration
+    if (t == ms / 2)
+    {
+      lost = rx.getStats().lost;
+      rx.setConfig(newRedundancy, NEW_KEEPALIVE, NEW_INTERVAL);
+    }
+    if (tx.configChanged())
+    {
+      const MD_GamepadLink::config_t &c = tx.getConfig();
+
+      configOk = (!changed && checkConfig(radio.check, redundancy, KEEPALIVE, INTERVAL) &&
+        c.version == 1 && c.redundancy == newRedundancy &&
+        c.keepalive == NEW_KEEPALIVE && c.interval == NEW_INTERVAL);
+      changed = true;
+      radio.newPhase();
+    }
+  }
+  configOk = configOk && checkConfig(radio.check, newRedundancy, NEW_KEEPALIVE, NEW_INTERVAL);
+
+  const MD_GamepadLinkRx<SimRadio>::stats_t &s = rx.getStats();
+
+  printf("%5.1f%% %4u %8u %6.1f%% %8u %8u %6u %6u %8.2f %6u %8u %6u %s\n",
+    loss, redundancy, radio.sent, 100.0 * radio.lost / radio.sent,
+    s.records, s.duplicates, s.lost, lost,
+    latencyCount ? (double)latencySum / latencyCount : 0.0, latencyMax,
+    unsynced, wrong, configOk ? "ok" : "FAIL");
+
+  return(configOk && wrong == 0);
+}
+
+int main(int argc, char *argv[])
+{
+  double loss = (argc > 1 ? atof(argv[1]) : -1);
+  uint32_t ms = (argc > 2 ? atof(argv[2]) : 60) * 1000;
+  const double losses[] = { 0, 1, 5, 10, 20 };
+  uint32_t lost[LINK_REDUNDANCY_MAX + 1];
+  bool ok = true;
+
+  printf("  loss  red  payloads   lost  records  repeats  r.lost  first  lat(ms) lat.max unsynced  wrong config\n");
+  for (uint8_t i = 0; i < sizeof(losses) / sizeof(losses[0]); i++)
+  {
+    if (loss >= 0 && i > 0)
+      break;
+    for (uint8_t r = 0; r <= LINK_REDUNDANCY_MAX; r++)
+      ok = run(loss >= 0 ? loss : losses[i], r, ms, lost[r]) && ok;
+
+    // each extra payload repeated must lose fewer records, until none are lost
+    for (uint8_t r = 1; r <= LINK_REDUNDANCY_MAX; r++)
+    {
+      if (lost[r - 1] == 0 ? lost[r] == 0 : lost[r] < lost[r - 1])
+        continue;
+      printf("FAIL: records lost with redundancy %u (%u) not fewer than with %u (%u)\n", r, lost[r], r - 1, lost[r - 1]);
+      ok = false;
+    }
+  }
+
+  return(ok ? 0 : 1);
+}
@@ -0,0 +1,171 @@
+// Stream simulator for testing the MD_Gamepad host decoder without hardware
+//
+// Encodes a simulated gamepad state (the joystick moving in a circle and the
+// switches pressed in turn) with MD_GamepadStream at a fixed update rate, as the
+// MD_Gamepad_Stream example does, and writes the frames to stdout, a file or
+// a pty. Frames can be dropped, corrupted or sent twice at random to check the
+// decoder. The last frame is always sent intact, so the decoder can count all
+// the frames lost.
+//
+// Build and run from the library folder:
+//   g++ -std=c++11 -O2 -Isrc -o gamepad_sim extras/host/MD_Gamepad_StreamSim.cpp
+//   ./gamepad_sim [-r rate] [-t seconds] [-d drop%] [-c corrupt%] [-u duplicate%] [-p | -o file]
+//
+// -r sets the updates per second (default 200) and -t the run time (default
+// forever). -p creates a pty and prints its name, for gamepad_decode to open.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <MD_Gamepad_Stream.h>
+
+static volatile sig_atomic_t stop = 0;
+
+static void onSignal(int) { stop = 1; }
+
+// Create a pty, returning the master. The slave is kept open in raw mode so
+// frames written before the decoder opens it are buffered, not echoed.
+static int openPty(int &slave)
+{
+  struct termios t;
+  int m = posix_openpt(O_RDWR | O_NOCTTY);
+
+  if (m < 0 || grantpt(m) != 0 || unlockpt(m) != 0)
+    return(-1);
+  slave = open(ptsname(m), O_RDWR | O_NOCTTY);
+  if (slave < 0 || tcgetattr(slave, &t) != 0)
+    return(-1);
+  cfmakeraw(&t);
+  tcsetattr(slave, TCSANOW, &t);
+  fprintf(stderr, "%s\n", ptsname(m));
+
+  return(m);
+}
+
+int main(int argc, char *argv[])
+{
+  long rate = 200;
+  double seconds = 0, drop = 0, corrupt = 0, duplicate = 0;
+  bool pty = false;
+  const char *file = nullptr;
+  int opt, fd = STDOUT_FILENO, slave = -1;
+  uint32_t sent = 0, dropped = 0, corrupted = 0, duplicated = 0;
+  MD_GamepadStream stream;
+
+  while ((opt = getopt(argc, argv, "r:t:d:c:u:po:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'r': rate = strtol(optarg, nullptr, 10); break;
+    case 't': seconds = strtod(optarg, nullptr); break;
+    case 'd': drop = strtod(optarg, nullptr); break;
+    case 'c': corrupt = strtod(optarg, nullptr); break;
+    case 'u': duplicate = strtod(optarg, nullptr); break;
+    case 'p': pty = true; break;
+    case 'o': file = optarg; break;
+    default:
+      fprintf(stderr, "Usage: %s [-r rate] [-t seconds] [-d drop%%] [-c corrupt%%] [-u duplicate%%] [-p | -o file]\n", argv[0]);
+      return(1);
+    }
+  }
+  if (rate <= 0 || rate > 10000)
+  {
+    fprintf(stderr, "Rate must be 1 to 10000\n");
+    return(1);
+  }
+
+  if (pty)
+    fd = openPty(slave);
+  else if (file != nullptr)
+    fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    fprintf(stderr, "Cannot open output: %s\n", strerror(errno));
+    return(1);
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, onSignal);
+  srand(1);
+  stream.begin(1000);
+
+  // time is simulated when writing a file, so it runs as fast as possible
+  bool realTime = (file == nullptr);
+  struct timespec next;
+  uint64_t periodNs = 1000000000 / rate;
+  uint64_t count = (seconds > 0 ? (uint64_t)(seconds * rate) : UINT64_MAX);
+
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  for (uint64_t i = 0; i < count && !stop; i++)
+  {
+    uint32_t now = (uint32_t)(i * periodNs / 1000000);
+    double a = 2 * M_PI * now / 4000.0;   // one joystick circle every 4 seconds
+    uint16_t sw = ((now / 500) % 4 == 0) ? (1 << ((now / 2000) % 7)) : 0;
+    int16_t x = (int16_t)(20000 * cos(a));
+    int16_t y = (int16_t)(20000 * sin(a));
+
+    // the joystick stops for 2 seconds in every 6 to check the keepalives
+    if ((now / 2000) % 3 == 2)
+      x = y = 0;
+
+    uint8_t n = stream.encode(now, sw, x, y);
+
+    if (n != 0)
+    {
+      uint8_t buf[MD_GamepadStream::FRAME_MAX];
+
+      bool last = (i + 1 == count);
+
+      memcpy(buf, stream.data(), n);
+      sent++;
+      if (last)
+        ;   // always sent intact
+      else if (100.0 * rand() / RAND_MAX < drop)
+      {
+        dropped++;
+        n = 0;
+      }
+      else if (100.0 * rand() / RAND_MAX < corrupt)
+      {
+        // flip one bit in the frame, not in the delimiter
+        buf[rand() % (n - 1)] ^= 1 << (rand() % 8);
+        corrupted++;
+      }
+      else if (100.0 * rand() / RAND_MAX < duplicate)
+      {
+        if (write(fd, buf, n) != n)
+          break;
+        duplicated++;
+      }
+      if (n != 0 && write(fd, buf, n) != n)
+        break;
+    }
+
+    if (realTime)
+    {
+      next.tv_nsec += periodNs;
+      while (next.tv_nsec >= 1000000000) { next.tv_nsec -= 1000000000; next.tv_sec++; }
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+    }
+  }
+
+  fprintf(stderr, "Frames %u, dropped %u, corrupted %u, duplicated %u\n", sent, dropped, corrupted, duplicated);
+  if (pty)
+  {
+    // leave time for the decoder to read the last frames
+    sleep(1);
+    close(slave);
+  }
+  if (fd != STDOUT_FILENO)
+    close(fd);
+
+  return(0);
+}
@@ -0,0 +1,53 @@
+// Minimal unit test framework for the MD_Gamepad host tests
+//
+// Each test is a function run with RUN(), making checks with CHECK() and
+// CHECK_EQ(). A failed check prints the file, line and expression and the
+// test carries on. main() returns testResult(), which is 1 if any check
+// failed, so the make check target fails.
+//
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+static const char *testName = "";   // the test running
+static uint32_t testChecks = 0;     // checks made
+static uint32_t testFailed = 0;     // checks failed
+
+#define CHECK(c)       testCheck((c), #c, __FILE__, __LINE__)                         ///< Check a condition is true
+#define CHECK_EQ(a, b) testCheckEq((int64_t)(a), (int64_t)(b), #a, #b, __FILE__, __LINE__) ///< Check two values are equal
+#define RUN(t)         testRun(t, #t)                                                 ///< Run a test function
+
+static inline void testCheck(bool ok, const char *expr, const char *file, int line)
+{
+  testChecks++;
+  if (ok)
+    return;
+  testFailed++;
+  printf("%s:%d: %s: CHECK(%s) failed\n", file, line, testName, expr);
+}
+
+static inline void testCheckEq(int64_t a, int64_t b, const char *exprA, const char *exprB, const char *file, int line)
+{
+  testChecks++;
+  if (a == b)
+    return;
+  testFailed++;
+  printf("%s:%d: %s: CHECK_EQ(%s, %s) failed, %lld != %lld\n", file, line, testName, exprA, exprB, (long long)a, (long long)b);
+}
+
+static inline void testRun(void (*test)(void), const char *name)
+{
+  uint32_t failed = testFailed;
+
+  testName = name;
+  test();
+  printf("%-40s %s\n", name, testFailed == failed ? "ok" : "FAIL");
+}
+
+static inline int testResult(void)
+{
+  printf("%u checks, %u failed\n", testChecks, testFailed);
+
+  return(testFailed == 0 ? 0 : 1);
+}
@@ -0,0 +1,815 @@
+// Unit tests for the MD_Gamepad library on the simulated hardware
+//
+// Covers the switch reads, the joystick deadband and the read throttling, and
+// checks the hardware accesses each method makes using the MD_GamepadHAL
+// counters, so a change that adds accesses to the hot paths fails the tests.
+//
+// This is the default build, with the switches read by digitalRead(). The
+// other test programs cover the GAMEPAD_PORT_IO, GAMEPAD_ADC_ISR and
+// GAMEPAD_PCINT options, which need a separate build each.
+//
+// Build and run all the tests from the library folder with
+//   make -C extras/host check
+//
+#include <MD_Gamepad.h>
+#include "MD_GamepadTest.h"
+
+// Configuration with the optional input processing selected
+struct FullConfig : MD_GamepadShield
+{
+  typedef MD_GamepadRepeat<REPEAT_INPUTS> Repeat;
+  typedef MD_GamepadCombo Combo;
+  typedef MD_GamepadQueue<MD_GamepadEvent, EVENT_QUEUE_SIZE> Events;
+  typedef MD_GamepadGesture<GESTURE_INPUTS> Gesture;
+};
+
+// Configuration with the event queue only
+struct EventsConfig : MD_GamepadShield
+{
+  typedef MD_GamepadQueue<MD_GamepadEvent, EVENT_QUEUE_SIZE> Events;
+};
+
+typedef MD_GamepadT<FullConfig> MD_GamepadFull;
+typedef MD_GamepadT<EventsConfig> MD_GamepadEvents;
+
+// Reset the hardware and start the gamepad at time 0, with the counters cleared
+template <class T>
+static void start(T &pad)
+{
+  MD_GamepadHAL::reset();
+  pad.begin();
+  MD_GamepadHAL::clearCount();
+}
+
+// Call update() every millisecond for ms milliseconds
+template <class T>
+static void runFor(T &pad, uint32_t ms)
+{
+  for (uint32_t i = 0; i < ms; i++)
+  {
+    MD_GamepadHAL::advance(1);
+    pad.update();
+  }
+}
+
+// Total of the hardware access counters
+static uint32_t accesses(void)
+{
+  const MD_GamepadHAL::count_t &c = MD_GamepadHAL::count;
+
+  return(c.millis + c.micros + c.pinMode + c.digitalRead + c.analogRead + c.portRead + c.adcRead + c.isr);
+}
+
+static void testBegin(void)
+{
+  MD_Gamepad pad{};
+
+  MD_GamepadHAL::reset();
+  pad.begin();
+
+  // 7 switches and 2 axes set up, and 16 conversions for each axis center
+  CHECK_EQ(MD_GamepadHAL::count.pinMode, 9);
+  CHECK_EQ(MD_GamepadHAL::count.analogRead, 32);
+  CHECK_EQ(MD_GamepadHAL::count.digitalRead, 0);
+  CHECK_EQ(MD_GamepadHAL::pinModes[MD_GamepadShield::PIN_A], INPUT_PULLUP);
+  CHECK_EQ(MD_GamepadHAL::pinModes[MD_GamepadShield::PIN_K], INPUT_PULLUP);
+  CHECK_EQ(pad.getCalibration(MD_Gamepad::SW_X).center, 512 << MAX_OVERSAMPLE);
+}
+
+static void testGetSwitch(void)
+{
+  MD_Gamepad pad{};
+
+  start(pad);
+  runFor(pad, 100);
+  CHECK_EQ(pad.getSwitch(), MD_Gamepad::SW_NONE);
+
+  // the switch is debounced after 4 scans and read at the next read delay
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_C, true);
+  runFor(pad, 100);
+  CHECK_EQ(pad.getSwitch(), MD_Gamepad::SW_C);
+  CHECK_EQ(pad.getState(), MD_Gamepad::swBit(MD_Gamepad::SW_C));
+
+  // between the reads the snapshot is kept but getSwitch() has nothing new
+  runFor(pad, 1);
+  CHECK_EQ(pad.getSwitch(), MD_Gamepad::SW_NONE);
+  CHECK(pad.anyKey());
+  runFor(pad, 99);
+  CHECK_EQ(pad.getSwitch(), MD_Gamepad::SW_C);
+
+  // the first switch is returned when more than one is pressed
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_C, false);
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_E, true);
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_B, true);
+  runFor(pad, 100);
+  CHECK_EQ(pad.getSwitch(), MD_Gamepad::SW_B);
+  CHECK_EQ(pad.getState(), MD_Gamepad::swBit(MD_Gamepad::SW_B) | MD_Gamepad::swBit(MD_Gamepad::SW_E));
+
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_B, false);
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_E, false);
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_K, true);
+  runFor(pad, 100);
+  CHECK_EQ(pad.getSwitch(), MD_Gamepad::SW_K);
+
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_K, false);
+  runFor(pad, 100);
+  CHECK_EQ(pad.getSwitch(), MD_Gamepad::SW_NONE);
+  CHECK(!pad.anyKey());
+}
+
+static void testDebounce(void)
+{
+  MD_Gamepad pad{};
+  bool seen = false;
+
+  start(pad);
+
+  // a press seen by 3 scans is ignored
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_A, true);
+  for (uint8_t i = 0; i < 15; i++)
+  {
+    runFor(pad, 1);
+    seen = seen || pad.anyKey();
+  }
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_A, false);
+  for (uint8_t i = 0; i < 100; i++)
+  {
+    runFor(pad, 1);
+    seen = seen || pad.anyKey();
+  }
+  CHECK(!seen);
+
+  // a press seen by 4 scans is accepted
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_A, true);
+  runFor(pad, 15);
+  CHECK(!pad.anyKey());
+  runFor(pad, 5);
+  CHECK_EQ(pad.getState(), MD_Gamepad::swBit(MD_Gamepad::SW_A));
+  CHECK_EQ(pad.getPressed(), MD_Gamepad::swBit(MD_Gamepad::SW_A));
+}
+
+static void testDeadband(void)
+{
+  MD_Gamepad pad{};
+  struct { uint16_t db; int16_t in, out; } const cases[] =
+  {
+    { DEFAULT_DB, 4, 0 }, { DEFAULT_DB, -4, 0 }, { DEFAULT_DB, 5, 5 }, { DEFAULT_DB, -5, -5 },
+    { 20, 19, 0 }, { 20, -19, 0 }, { 20, 20, 20 }, { 20, -20, -20 }, { 20, -300, -300 },
+    { 0, 1, 1 }, { 0, -1, -1 }, { 0, 511, 511 }, { 0, -512, -512 },
+  };
+
+  start(pad);
+  pad.setReadDelay(0);
+  for (uint8_t i = 0; i < ARRAY_SIZE(cases); i++)
+  {
+    if (cases[i].db != DEFAULT_DB) pad.setDeadband(cases[i].db);
+    MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 512 + cases[i].in);
+    MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 512 - cases[i].in);
+    runFor(pad, 1);
+    CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_X), cases[i].out);
+    CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_Y), -cases[i].out);
+  }
+}
+
+static void testThrottle(void)
+{
+  // the default read delay reads every channel every 100ms and scans every 5ms
+  {
+    MD_Gamepad pad{};
+    uint16_t frames = 0;
+
+    start(pad);
+    for (uint16_t i = 0; i < 1000; i++)
+    {
+      MD_GamepadHAL::advance(1);
+      frames += pad.update();
+    }
+    CHECK_EQ(frames, 10);
+    CHECK_EQ(MD_GamepadHAL::count.millis, 1000);
+    CHECK_EQ(MD_GamepadHAL::count.analogRead, 2 * 10);
+    CHECK_EQ(MD_GamepadHAL::count.digitalRead, 7 * 200);
+  }
+
+  // each axis is timed separately
+  {
+    MD_Gamepad pad{};
+
+    start(pad);
+    pad.setReadDelay(MD_Gamepad::SW_X, 10);
+    pad.setReadDelay(MD_Gamepad::SW_Y, 50);
+    runFor(pad, 1000);
+    CHECK_EQ(MD_GamepadHAL::count.analogRead, 100 + 20);
+  }
+
+  // the read delay is the minimum time between reads, not a period
+  {
+    MD_Gamepad pad{};
+
+    start(pad);
+    pad.setReadDelay(MD_Gamepad::SW_X, 10);
+    pad.setReadDelay(MD_Gamepad::SW_Y, 1000);
+    for (uint16_t i = 0; i < 100; i++)
+    {
+      MD_GamepadHAL::advance(7);
+      pad.update();
+    }
+    CHECK_EQ(MD_GamepadHAL::count.analogRead, 50);
+  }
+
+  // a debounce delay of 1ms scans on every update
+  {
+    MD_Gamepad pad{};
+
+    start(pad);
+    pad.setDebounceDelay(1);
+    runFor(pad, 1000);
+    CHECK_EQ(MD_GamepadHAL::count.digitalRead, 7 * 1000);
+  }
+}
+
+static void testUpdateCount(void)
+{
+  const MD_GamepadHAL::count_t &c = MD_GamepadHAL::count;
+  const MD_GamepadHAL::cost_t &cost = MD_GamepadHAL::cost;
+  MD_Gamepad pad{};
+
+  // nothing due reads only the clock
+  start(pad);
+  runFor(pad, 1);
+  CHECK_EQ(c.millis, 1);
+  CHECK_EQ(accesses(), 1);
+  CHECK_EQ(c.cycles, cost.millis);
+
+  // a switch scan
+  runFor(pad, 3);
+  MD_GamepadHAL::clearCount();
+  runFor(pad, 1);
+  CHECK_EQ(c.digitalRead, 7);
+  CHECK_EQ(accesses(), 1 + 7);
+  CHECK_EQ(c.cycles, cost.millis + 7 * cost.digitalRead);
+
+  // a scan and both axes
+  runFor(pad, 94);
+  MD_GamepadHAL::clearCount();
+  runFor(pad, 1);
+  CHECK_EQ(c.digitalRead, 7);
+  CHECK_EQ(c.analogRead, 2);
+  CHECK_EQ(accesses(), 1 + 7 + 2);
+  CHECK_EQ(c.cycles, cost.millis + 7 * cost.digitalRead + 2 * cost.analogRead);
+
+  // the getters only read the snapshot
+  MD_GamepadEvent e;
+
+  MD_GamepadHAL::clearCount();
+  pad.getSwitch();
+  pad.anyKey();
+  pad.getState();
+  pad.getPressed();
+  pad.getJoystickValue(MD_Gamepad::SW_X);
+  pad.getJoystickDirection(MD_Gamepad::SW_Y);
+  pad.getJoystickMagnitude();
+  pad.getEvent(e);
+  CHECK_EQ(accesses(), 0);
+}
+
+static void testOversample(void)
+{
+  MD_Gamepad pad{};
+
+  // 4^n conversions per axis for n extra bits
+  start(pad);
+  pad.setReadDelay(0);
+  pad.setDebounceDelay(1000);
+  for (uint8_t n = 0; n <= 3; n++)
+  {
+    pad.setOversample(n);
+    MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 600);
+    MD_GamepadHAL::clearCount();
+    runFor(pad, 1);
+    CHECK_EQ(MD_GamepadHAL::count.analogRead, 2 << (2 * n));
+    CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_X), (600 - 512) << n);
+  }
+
+  // limited so update() does not block for too long
+  pad.setOversample(MAX_OVERSAMPLE);
+  MD_GamepadHAL::clearCount();
+  runFor(pad, 1);
+  CHECK_EQ(MD_GamepadHAL::count.analogRead, 2 << (2 * MAX_OVERSAMPLE_POLLED));
+  CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_X), (600 - 512) << MAX_OVERSAMPLE_POLLED);
+}
+
+// Set both axes and update, returning the X axis value in x and Y in y
+template <class T>
+static void readAxes(T &pad, uint16_t rawX, uint16_t rawY, int16_t &x, int16_t &y)
+{
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, rawX);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, rawY);
+  runFor(pad, 1);
+  x = pad.getJoystickValue(MD_Gamepad::SW_X);
+  y = pad.getJoystickValue(MD_Gamepad::SW_Y);
+}
+
+static void testOutputRange(void)
+{
+  MD_Gamepad pad{};
+  MD_Gamepad::calib_t c;
+  int16_t x, y;
+
+  start(pad);
+  pad.setReadDelay(0);
+  pad.setDeadband(0);
+
+  // the default calibration is the full analog range, with the 16 bit max
+  // computed unsigned
+  c = pad.getCalibration(MD_Gamepad::SW_X);
+  CHECK_EQ(c.min, 0);
+  CHECK_EQ(c.center, 512 << MAX_OVERSAMPLE);
+  CHECK_EQ(c.max, 65472);
+  CHECK_EQ(c.max, 1023UL << MAX_OVERSAMPLE);
+
+  // each half of the travel is scaled to the range, so both ends are full scale
+  const uint16_t ranges[] = { 127, 1000, INT16_MAX };
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(ranges); i++)
+  {
+    pad.setOutputRange(ranges[i]);
+    readAxes(pad, 1023, 0, x, y);
+    CHECK_EQ(x, ranges[i]);
+    CHECK_EQ(y, -ranges[i]);
+    readAxes(pad, 0, 1023, x, y);
+    CHECK_EQ(x, -ranges[i]);
+    CHECK_EQ(y, ranges[i]);
+    readAxes(pad, 512, 512, x, y);
+    CHECK_EQ(x, 0);
+    CHECK_EQ(y, 0);
+
+    // and the value rises steadily across the travel
+    int16_t prev = -ranges[i];
+
+    for (uint16_t raw = 0; raw <= 1023; raw += 7)
+    {
+      readAxes(pad, raw, 512, x, y);
+      CHECK(x >= prev);
+      prev = x;
+    }
+  }
+
+  // 0 turns normalization off
+  pad.setOutputRange(0);
+  readAxes(pad, 1023, 0, x, y);
+  CHECK_EQ(x, 511);
+  CHECK_EQ(y, -512);
+}
+
+static void testCalibration(void)
+{
+  MD_Gamepad pad{};
+  MD_Gamepad::calib_t c;
+  int16_t x, y;
+
+  start(pad);
+  pad.setReadDelay(0);
+  pad.setDeadband(0);
+  pad.setOutputRange(127);
+
+  // a sweep over the travel of a joystick centered off the middle is accepted
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 500);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 540);
+  pad.calibrateStart();
+  for (uint16_t k = 0; k <= 800; k += 4)
+    readAxes(pad, 100 + k, 940 - k, x, y);
+  CHECK(pad.calibrateEnd());
+
+  c = pad.getCalibration(MD_Gamepad::SW_X);
+  CHECK_EQ(c.min, 100 << MAX_OVERSAMPLE);
+  CHECK_EQ(c.center, 500 << MAX_OVERSAMPLE);
+  CHECK_EQ(c.max, 900 << MAX_OVERSAMPLE);
+  c = pad.getCalibration(MD_Gamepad::SW_Y);
+  CHECK_EQ(c.min, 140 << MAX_OVERSAMPLE);
+  CHECK_EQ(c.center, 540 << MAX_OVERSAMPLE);
+  CHECK_EQ(c.max, 940 << MAX_OVERSAMPLE);
+
+  // the calibrated travel is symmetrical about the center and saturates beyond
+  readAxes(pad, 500, 540, x, y);
+  CHECK_EQ(x, 0); CHECK_EQ(y, 0);
+  readAxes(pad, 900, 140, x, y);
+  CHECK_EQ(x, 127); CHECK_EQ(y, -127);
+  readAxes(pad, 100, 940, x, y);
+  CHECK_EQ(x, -127); CHECK_EQ(y, 127);
+  readAxes(pad, 1023, 0, x, y);
+  CHECK_EQ(x, 127); CHECK_EQ(y, -127);
+  for (uint16_t d = 1; d < 400; d += 3)
+  {
+    int16_t xn, yn;
+
+    readAxes(pad, 500 + d, 540 + d, x, y);
+    readAxes(pad, 500 - d, 540 - d, xn, yn);
+    CHECK(xn == -x && yn == -y);
+  }
+
+  // a sweep that only moves one side far enough is rejected and the previous
+  // calibration is restored
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 512);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 512);
+  pad.calibrateStart();
+  for (uint16_t k = 0; k <= 800; k += 4)
+    readAxes(pad, 112 + k, 400 + k / 4, x, y);
+  CHECK(!pad.calibrateEnd());
+
+  c = pad.getCalibration(MD_Gamepad::SW_X);
+  CHECK_EQ(c.min, 100 << MAX_OVERSAMPLE);
+  CHECK_EQ(c.center, 500 << MAX_OVERSAMPLE);
+  CHECK_EQ(c.max, 900 << MAX_OVERSAMPLE);
+  c = pad.getCalibration(MD_Gamepad::SW_Y);
+  CHECK_EQ(c.min, 140 << MAX_OVERSAMPLE);
+  CHECK_EQ(c.center, 540 << MAX_OVERSAMPLE);
+  readAxes(pad, 900, 140, x, y);
+  CHECK_EQ(x, 127); CHECK_EQ(y, -127);
+
+  // a sweep without any movement is rejected too
+  pad.calibrateStart();
+  runFor(pad, 100);
+  CHECK(!pad.calibrateEnd());
+  CHECK_EQ(pad.getCalibration(MD_Gamepad::SW_X).center, 500 << MAX_OVERSAMPLE);
+
+  // a saved calibration is used as set
+  c.min = 200 << MAX_OVERSAMPLE;
+  c.center = 600 << MAX_OVERSAMPLE;
+  c.max = 1000 << MAX_OVERSAMPLE;
+  pad.setCalibration(MD_Gamepad::SW_X, c);
+  readAxes(pad, 1000, 540, x, y);
+  CHECK_EQ(x, 127);
+  readAxes(pad, 200, 540, x, y);
+  CHECK_EQ(x, -127);
+  readAxes(pad, 600, 540, x, y);
+  CHECK_EQ(x, 0);
+}
+
+static void testMagnitude(void)
+{
+  MD_Gamepad pad{};
+
+  start(pad);
+  pad.setReadDelay(0);
+  pad.setOutputRange(INT16_MAX);
+
+  // full deflection on both axes
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 1023);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 0);
+  runFor(pad, 1);
+  CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_X), INT16_MAX);
+  CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_Y), -INT16_MAX);
+  CHECK_EQ(pad.getJoystickMagnitude(), 46339);
+  CHECK(pad.getJoystickAngle() >= 0xe000 - 1 && pad.getJoystickAngle() <= 0xe000 + 1);
+  CHECK_EQ(pad.getJoystickSector(), 7);
+
+  // one axis only
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 512);
+  runFor(pad, 1);
+  CHECK_EQ(pad.getJoystickMagnitude(), INT16_MAX);
+  CHECK_EQ(pad.getJoystickAngle(), 0);
+  CHECK_EQ(pad.getJoystickSector(), 0);
+
+  // centered
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 512);
+  runFor(pad, 1);
+  CHECK_EQ(pad.getJoystickMagnitude(), 0);
+  CHECK_EQ(pad.getJoystickSector(), MD_GamepadSector::CENTER);
+}
+
+// Hold switch A for ms milliseconds and count the updates where it fired
+template <class T>
+static uint16_t holdFired(T &pad, uint32_t ms)
+{
+  uint16_t fired = 0;
+
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_A, true);
+  for (uint32_t i = 0; i < ms; i++)
+  {
+    runFor(pad, 1);
+    fired += (pad.getRepeat() == MD_Gamepad::swBit(MD_Gamepad::SW_A));
+  }
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_A, false);
+  runFor(pad, 100);
+
+  return(fired);
+}
+
+static void testRepeat(void)
+{
+  // without auto repeat in the configuration a held switch only fires when pressed
+  {
+    MD_Gamepad pad{};
+
+    start(pad);
+    pad.setDebounceDelay(1);
+    pad.setRepeat(100, 50);
+    CHECK_EQ(holdFired(pad, 500), 1);
+  }
+
+  // with auto repeat it fires when pressed, after the delay and then every interval
+  {
+    MD_GamepadFull pad{};
+
+    start(pad);
+    pad.setDebounceDelay(1);
+    CHECK_EQ(holdFired(pad, 500), 1);
+    pad.setRepeat(MD_Gamepad::SW_A, 100, 50);
+    CHECK_EQ(holdFired(pad, 500), 1 + 8);
+  }
+
+  // and costs the RAM for the settings
+  CHECK(sizeof(MD_GamepadFull) > sizeof(MD_Gamepad) + REPEAT_INPUTS * sizeof(MD_GamepadRepeat<1>::config_t));
+}
+
+// Press switches A and B together and count the updates where the chord matched
+template <class T>
+static uint16_t chordMatched(T &pad)
+{
+  static const MD_GamepadComboDef chord[] =
+  {
+    { MD_GamepadComboDef::CHORD, 50, 1, { MD_Gamepad::swBit(MD_Gamepad::SW_A) | MD_Gamepad::swBit(MD_Gamepad::SW_B) } },
+  };
+  uint16_t matched = 0;
+
+  pad.setCombos(chord, 1);
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_A, true);
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_B, true);
+  for (uint8_t i = 0; i < 100; i++)
+  {
+    runFor(pad, 1);
+    matched += (pad.getCombo() == 1);
+  }
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_A, false);
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_B, false);
+  runFor(pad, 100);
+
+  return(matched);
+}
+
+static void testCombo(void)
+{
+  MD_GamepadHistory::entry_t e = MD_GamepadHistory::entry_t();
+
+  // without combos in the configuration nothing is matched or kept in the history
+  {
+    MD_Gamepad pad{};
+
+    start(pad);
+    pad.setDebounceDelay(1);
+    CHECK_EQ(chordMatched(pad), 0);
+    CHECK(!pad.getHistory(0, e));
+  }
+
+  // with combos the chord is matched once and the press is in the history
+  {
+    MD_GamepadFull pad{};
+
+    start(pad);
+    pad.setDebounceDelay(1);
+    CHECK_EQ(chordMatched(pad), 1);
+    CHECK(pad.getHistory(0, e));
+    CHECK_EQ(e.pressed, MD_Gamepad::swBit(MD_Gamepad::SW_A) | MD_Gamepad::swBit(MD_Gamepad::SW_B));
+  }
+
+  // and costs the RAM for the history
+  CHECK(sizeof(MD_GamepadFull) > sizeof(MD_Gamepad) + sizeof(MD_GamepadHistory) + sizeof(MD_GamepadCombo));
+}
+
+static void testEvents(void)
+{
+  MD_GamepadEvent e = MD_GamepadEvent();
+
+  // without the event queue in the configuration no events are returned
+  {
+    MD_Gamepad pad{};
+
+    start(pad);
+    pad.setDebounceDelay(1);
+    holdFired(pad, 10);
+    CHECK(!pad.getEvent(e));
+    CHECK_EQ(pad.getEventsDropped(), 0);
+  }
+
+  // with the queue the press and release are returned in order
+  {
+    MD_GamepadFull pad{};
+
+    start(pad);
+    pad.setDebounceDelay(1);
+    holdFired(pad, 10);
+    CHECK(pad.getEvent(e));
+    CHECK_EQ(e.type, MD_GamepadEvent::EV_PRESS);
+    CHECK_EQ(e.id, MD_Gamepad::SW_A);
+    CHECK(pad.getEvent(e));
+    CHECK_EQ(e.type, MD_GamepadEvent::EV_RELEASE);
+    CHECK_EQ(e.id, MD_Gamepad::SW_A);
+    CHECK(!pad.getEvent(e));
+  }
+
+  // and costs the RAM for the queue
+  CHECK(sizeof(MD_GamepadFull) > sizeof(MD_Gamepad) + EVENT_QUEUE_SIZE * sizeof(MD_GamepadEvent));
+}
+
+// Set the X and Y axis values, with normalization off, for n updates with
+// noise of up to +/-noise added, and return the number of EV_AXIS events
+// for the axis sw with the last event value in dir
+template <class T>
+static uint8_t axisNoise(T &pad, MD_Gamepad::switch_t sw, int16_t x, int16_t y, int16_t noise, uint16_t n, int8_t &dir)
+{
+  static uint32_t seed = 1;
+  MD_GamepadEvent e = MD_GamepadEvent();
+  uint8_t count = 0;
+
+  for (uint16_t i = 0; i < n; i++)
+  {
+    int16_t d = 0;
+
+    if (noise != 0)
+    {
+      seed = seed * 1103515245UL + 12345;
+      d = (int16_t)((seed >> 16) % (2 * noise + 1)) - noise;
+    }
+    MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 512 + x + (sw == MD_Gamepad::SW_X ? d : 0));
+    MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 512 + y + (sw == MD_Gamepad::SW_Y ? d : 0));
+    runFor(pad, 1);
+    while (pad.getEvent(e))
+      if (e.type == MD_GamepadEvent::EV_AXIS && e.id == sw)
+      {
+        count++;
+        dir = e.value;
+      }
+  }
+
+  return(count);
+}
+
+static void testDirection(void)
+{
+  MD_GamepadEvents pad{};
+  int8_t dir = 0;
+
+  start(pad);
+  pad.setReadDelay(0);
+  pad.setDeadband(0);
+  pad.setOutputRange(0);
+  pad.setDirectionThresholds(MD_Gamepad::SW_X, 200, 100);
+
+  // noise across the engage threshold engages the direction exactly once
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, 0, 0, 0, 10, dir), 0);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, 170, 0, 20, 50, dir), 0);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, 200, 0, 20, 500, dir), 1);
+  CHECK_EQ(dir, 1);
+  CHECK_EQ(pad.getJoystickDirection(MD_Gamepad::SW_X), 1);
+
+  // noise between the thresholds and across the release threshold releases
+  // it exactly once
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, 150, 0, 45, 500, dir), 0);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, 100, 0, 20, 500, dir), 1);
+  CHECK_EQ(dir, 0);
+  CHECK_EQ(pad.getJoystickDirection(MD_Gamepad::SW_X), 0);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, 150, 0, 45, 500, dir), 0);
+
+  // the negative side is the same
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, -200, 0, 20, 500, dir), 1);
+  CHECK_EQ(dir, -1);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, -100, 0, 20, 500, dir), 1);
+  CHECK_EQ(dir, 0);
+
+  // a reversal in one update is one event to the new direction
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, -250, 0, 0, 1, dir), 1);
+  CHECK_EQ(dir, -1);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, 250, 0, 0, 1, dir), 1);
+  CHECK_EQ(dir, 1);
+
+  // the thresholds are exact edges
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, 101, 0, 0, 1, dir), 0);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, 100, 0, 0, 1, dir), 1);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, 199, 0, 0, 1, dir), 0);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, 200, 0, 0, 1, dir), 1);
+  CHECK_EQ(dir, 1);
+
+  // each side of an axis has its own thresholds, and the other axis is
+  // not affected
+  pad.setDirectionThresholds(MD_Gamepad::SW_Y, -1, 300, 50);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_Y, 0, -299, 0, 1, dir), 0);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_Y, 0, -300, 0, 1, dir), 1);
+  CHECK_EQ(dir, -1);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_Y, 0, -51, 0, 1, dir), 0);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_Y, 0, -50, 0, 1, dir), 1);
+  CHECK_EQ(dir, 0);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_Y, 0, 1, 0, 1, dir), 1);
+  CHECK_EQ(dir, 1);
+  CHECK_EQ(pad.getJoystickDirection(MD_Gamepad::SW_X), 0);
+
+  // the release threshold is limited to below the engage threshold
+  pad.setDirectionThresholds(MD_Gamepad::SW_X, 100, 150);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, 100, 0, 0, 1, dir), 1);
+  CHECK_EQ(dir, 1);
+  CHECK_EQ(axisNoise(pad, MD_Gamepad::SW_X, 99, 0, 0, 1, dir), 1);
+  CHECK_EQ(dir, 0);
+}
+
+// Press switch A for down milliseconds, then release it for up milliseconds
+template <class T>
+static void tap(T &pad, uint32_t down, uint32_t up)
+{
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_A, true);
+  runFor(pad, down);
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_A, false);
+  runFor(pad, up);
+}
+
+// Get the next gesture event, skipping the other events
+template <class T>
+static bool nextGesture(T &pad, MD_GamepadEvent &e)
+{
+  while (pad.getEvent(e))
+    if (e.type >= MD_GamepadEvent::EV_CLICK)
+      return(true);
+
+  return(false);
+}
+
+static void testGesture(void)
+{
+  MD_GamepadEvent e = MD_GamepadEvent();
+
+  // with gestures in the configuration
+  {
+    MD_GamepadFull pad{};
+
+    start(pad);
+    pad.setDebounceDelay(1);
+    pad.setGestureTimes(300, 800);
+
+    // a click is reported once the double click time has passed
+    tap(pad, 50, 200);
+    CHECK(!nextGesture(pad, e));
+    runFor(pad, 200);
+    CHECK(nextGesture(pad, e));
+    CHECK_EQ(e.type, MD_GamepadEvent::EV_CLICK);
+    CHECK_EQ(e.id, MD_Gamepad::SW_A);
+    CHECK(!nextGesture(pad, e));
+
+    // a second press within the double click time is a double click only
+    tap(pad, 50, 100);
+    tap(pad, 50, 400);
+    CHECK(nextGesture(pad, e));
+    CHECK_EQ(e.type, MD_GamepadEvent::EV_DOUBLE_CLICK);
+    CHECK_EQ(e.id, MD_Gamepad::SW_A);
+    CHECK(!nextGesture(pad, e));
+
+    // a long press is reported while held, then the hold time on release
+    MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_A, true);
+    runFor(pad, 700);
+    CHECK(!nextGesture(pad, e));
+    runFor(pad, 200);
+    CHECK(nextGesture(pad, e));
+    CHECK_EQ(e.type, MD_GamepadEvent::EV_LONG_PRESS);
+    tap(pad, 100, 100);
+    CHECK(nextGesture(pad, e));
+    CHECK_EQ(e.type, MD_GamepadEvent::EV_HOLD_RELEASE);
+    CHECK_EQ(e.id, MD_Gamepad::SW_A);
+    CHECK_EQ(e.value, 1000);
+    CHECK(!nextGesture(pad, e));
+  }
+
+  // without gestures in the configuration the presses are queued but not classified
+  {
+    MD_GamepadEvents pad{};
+
+    start(pad);
+    pad.setDebounceDelay(1);
+    pad.setGestureTimes(300, 800);
+    tap(pad, 50, 400);
+    tap(pad, 1000, 400);
+    CHECK(pad.getEvent(e));
+    CHECK_EQ(e.type, MD_GamepadEvent::EV_PRESS);
+    CHECK(!nextGesture(pad, e));
+  }
+
+  // and the classifier costs the RAM for the switch data
+  CHECK(sizeof(MD_GamepadEvents) + sizeof(MD_GamepadGesture<GESTURE_INPUTS>) <= sizeof(MD_GamepadFull));
+}
+
+int main(void)
+{
+  RUN(testBegin);
+  RUN(testGetSwitch);
+  RUN(testDebounce);
+  RUN(testDeadband);
+  RUN(testThrottle);
+  RUN(testUpdateCount);
+  RUN(testOversample);
+  RUN(testOutputRange);
+  RUN(testCalibration);
+  RUN(testMagnitude);
+  RUN(testRepeat);
+  RUN(testCombo);
+  RUN(testEvents);
+  RUN(testDirection);
+  RUN(testGesture);
+
+  return(testResult());
+}
@@ -0,0 +1,238 @@
+// Unit tests for the GAMEPAD_ADC_ISR background joystick sampling
+//
+// The conversions are completed by MD_GamepadHAL_ADC::convert(), which calls
+// the ADC_vect interrupt handler as the ADC would on the target. The tests
+// check the handler alternates between the axes, saves each axis value and
+// decimates the oversampled conversions, that update() reads the saved
+// values without waiting for any conversion and that begin() again restarts
+// the conversions without oversampling. Full oversampling also gives the
+// most negative axis values, used to check the joystick magnitude.
+//
+#define GAMEPAD_ADC_ISR 1
+#include <MD_Gamepad.h>
+#include "MD_GamepadTest.h"
+
+static void start(MD_Gamepad &pad)
+{
+  MD_GamepadHAL::reset();
+  pad.begin();
+  pad.setReadDelay(0);
+  MD_GamepadHAL::clearCount();
+}
+
+// Complete n conversions
+static void convert(uint16_t n)
+{
+  while (n-- > 0)
+    MD_GamepadHAL_ADC::convert(ADC_vect);
+}
+
+// Complete the conversions until the value for the Y axis is saved, so the next
+// conversion starts a new X value
+static void sync(void)
+{
+  uint8_t axis;
+
+  do
+  {
+    axis = MD_GamepadADC::axis;
+    convert(1);
+  } while (!(axis == 1 && MD_GamepadADC::axis == 0));
+}
+
+static void testBegin(void)
+{
+  MD_Gamepad pad{};
+
+  start(pad);
+
+  // the first conversion is started on the X axis, and the center is used until it completes
+  CHECK_EQ(ADMUX, _BV(REFS0) | (MD_GamepadShield::PIN_X - A0));
+  CHECK(ADCSRA & _BV(ADEN));
+  CHECK(ADCSRA & _BV(ADIE));
+  CHECK(ADCSRA & _BV(ADSC));
+  CHECK_EQ(MD_GamepadADC::axis, 0);
+  CHECK_EQ(MD_GamepadADC::value[0], 512);
+  CHECK_EQ(MD_GamepadADC::value[1], 512);
+}
+
+static void testAlternate(void)
+{
+  MD_Gamepad pad{};
+
+  start(pad);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 100);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 900);
+
+  // each conversion saves the axis converted, switches to the other axis and starts again
+  for (uint8_t i = 0; i < 10; i++)
+  {
+    uint8_t axis = i & 1;
+
+    CHECK_EQ(MD_GamepadADC::axis, axis);
+    CHECK_EQ(ADMUX & 0x07, (axis == 0 ? MD_GamepadShield::PIN_X : MD_GamepadShield::PIN_Y) - A0);
+    CHECK(MD_GamepadHAL_ADC::convert(ADC_vect));
+    CHECK_EQ(MD_GamepadADC::value[axis], axis == 0 ? 100 : 900);
+    CHECK(ADCSRA & _BV(ADSC));
+  }
+  CHECK_EQ(MD_GamepadHAL::count.adcRead, 10);
+  CHECK_EQ(MD_GamepadHAL::count.isr, 10);
+
+  // the values follow the input
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 300);
+  convert(1);
+  CHECK_EQ(MD_GamepadADC::value[0], 300);
+  CHECK_EQ(MD_GamepadADC::value[1], 900);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 700);
+  convert(1);
+  CHECK_EQ(MD_GamepadADC::value[0], 300);
+  CHECK_EQ(MD_GamepadADC::value[1], 700);
+
+  // with the interrupt disabled the handler is not called
+  ADCSRA &= ~_BV(ADIE);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 0);
+  CHECK(MD_GamepadHAL_ADC::convert(ADC_vect));
+  CHECK_EQ(MD_GamepadADC::value[0], 300);
+  CHECK(!MD_GamepadHAL_ADC::convert(ADC_vect));
+}
+
+static void testUpdate(void)
+{
+  MD_Gamepad pad{};
+
+  start(pad);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 100);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 900);
+
+  // update() uses the center until the first conversions complete
+  MD_GamepadHAL::advance(1);
+  pad.update();
+  CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_X), 0);
+  CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_Y), 0);
+
+  // and then the saved values, without any analogRead()
+  convert(2);
+  MD_GamepadHAL::clearCount();
+  MD_GamepadHAL::advance(1);
+  pad.update();
+  CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_X), 100 - 512);
+  CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_Y), 900 - 512);
+  CHECK_EQ(MD_GamepadHAL::count.analogRead, 0);
+  CHECK_EQ(MD_GamepadHAL::count.adcRead, 0);
+}
+
+static void testDecimate(void)
+{
+  MD_Gamepad pad{};
+
+  start(pad);
+  for (uint8_t n = 1; n <= MAX_OVERSAMPLE; n++)
+  {
+    const uint16_t count = 1 << (2 * n);
+
+    pad.setOversample(n);
+    CHECK_EQ(MD_GamepadADC::shift, n);
+    sync();
+
+    // 4^n conversions are summed for each X value, half of them 1 count higher
+    bool onX = true;
+
+    MD_GamepadHAL::clearCount();
+    for (uint16_t k = 0; k < count; k++)
+    {
+      MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 700 + (k & 1));
+      onX = onX && MD_GamepadADC::axis == 0;
+      convert(1);
+    }
+    CHECK(onX);
+    CHECK_EQ(MD_GamepadADC::axis, 1);
+    CHECK_EQ(MD_GamepadHAL::count.adcRead, count);
+
+    // n extra bits, 700.5 scaled by 2^n
+    CHECK_EQ(MD_GamepadADC::value[0], (1401 << n) / 2);
+
+    // then 4^n conversions for Y, at full scale
+    MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 1023);
+    convert(count - 1);
+    CHECK_EQ(MD_GamepadADC::axis, 1);
+    convert(1);
+    CHECK_EQ(MD_GamepadADC::axis, 0);
+    CHECK_EQ(MD_GamepadADC::value[1], 1023 << n);
+
+    // update() scales the center to the same resolution
+    MD_GamepadHAL::advance(1);
+    pad.update();
+    CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_X), ((1401 << n) / 2) - (512 << n));
+  }
+}
+
+static void testRestart(void)
+{
+  MD_Gamepad pad{};
+
+  start(pad);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 100);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 900);
+
+  // begin() again after oversampling restarts with single conversions, the
+  // same as the first begin()
+  for (uint8_t n = 1; n <= MAX_OVERSAMPLE; n++)
+  {
+    pad.setOversample(n);
+    sync();
+    convert(2 << (2 * n));
+    CHECK_EQ(MD_GamepadADC::value[0], 100 << n);
+
+    // with the joystick centered, as begin() reads the center
+    MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 512);
+    MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 512);
+    pad.begin();
+    pad.setReadDelay(0);
+    CHECK_EQ(MD_GamepadADC::shift, 0);
+    CHECK_EQ(MD_GamepadADC::axis, 0);
+    CHECK_EQ(MD_GamepadADC::value[0], 512);
+    CHECK_EQ(MD_GamepadADC::value[1], 512);
+
+    MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 100);
+    MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 900);
+    convert(2);
+    CHECK_EQ(MD_GamepadADC::value[0], 100);
+    CHECK_EQ(MD_GamepadADC::value[1], 900);
+    MD_GamepadHAL::advance(1);
+    pad.update();
+    CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_X), 100 - 512);
+    CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_Y), 900 - 512);
+  }
+}
+
+static void testMagnitude(void)
+{
+  MD_Gamepad pad{};
+
+  start(pad);
+  pad.setOversample(MAX_OVERSAMPLE);
+
+  // both axes at the most negative value, where the sum of the squares is 2^31
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_X, 0);
+  MD_GamepadHAL::setAnalog(MD_GamepadShield::PIN_Y, 0);
+  sync();
+  convert(2 << (2 * MAX_OVERSAMPLE));
+  MD_GamepadHAL::advance(1);
+  pad.update();
+  CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_X), INT16_MIN);
+  CHECK_EQ(pad.getJoystickValue(MD_Gamepad::SW_Y), INT16_MIN);
+  CHECK_EQ(pad.getJoystickMagnitude(), 46340);
+  CHECK_EQ(pad.getJoystickSector(), 5);
+}
+
+int main(void)
+{
+  RUN(testBegin);
+  RUN(testAlternate);
+  RUN(testUpdate);
+  RUN(testDecimate);
+  RUN(testRestart);
+  RUN(testMagnitude);
+
+  return(testResult());
+}
@@ -0,0 +1,203 @@
+// Unit tests for the MD_Gamepad joystick response curves
+//
+// Covers the curve tables built by GAMEPAD_CURVE from curveExpo and curveS,
+// and the interpolation, scaling and sign symmetry of MD_GamepadCurve::apply()
+// in MD_Gamepad_Curve.h.
+//
+// Build and run all the tests from the library folder with
+//   make -C extras/host check
+//
+#include <MD_Gamepad.h>
+#include "MD_GamepadTest.h"
+
+GAMEPAD_CURVE(curveLinear, curveExpo, 0, 100);
+GAMEPAD_CURVE(curveCubic, curveExpo, 100, 100);
+GAMEPAD_CURVE(curveSoft, curveExpo, 40, 100);
+GAMEPAD_CURVE(curveHalf, curveExpo, 40, 50);
+GAMEPAD_CURVE(curveSmooth, curveS, 100, 100);
+
+// The curve tables used for the apply() tests
+static const uint16_t *const tables[] = { curveLinear, curveCubic, curveSoft, curveHalf, curveSmooth };
+
+// Axis full deflection values used for the apply() tests
+static const uint16_t ranges[] = { 127, 1000, 1024, 32767 };
+
+// Check a curve function starts at 0, rises steadily and ends at last
+template <class F>
+static void checkCurve(F f, uint16_t last)
+{
+  CHECK_EQ(f(0), 0);
+  CHECK_EQ(f(GAMEPAD_CURVE_POINTS - 1), last);
+  for (uint8_t i = 1; i < GAMEPAD_CURVE_POINTS; i++)
+    CHECK(f(i) >= f(i - 1));
+}
+
+static void testExpo(void)
+{
+  // every expo ends at full deflection, at any rate up to 100
+  for (uint8_t expo = 0; expo <= 100; expo += 5)
+  {
+    for (uint8_t rate = 25; rate <= 100; rate += 25)
+      checkCurve([=](uint8_t i) { return(curveExpo(i, expo, rate)); }, 32768U * rate / 100);
+
+    // and more expo is flatter in the center
+    if (expo > 0)
+      CHECK(curveExpo(8, expo, 100) < curveExpo(8, expo - 5, 100));
+  }
+
+  // expo 0 is linear and expo 100 is cubic
+  for (uint8_t i = 0; i < GAMEPAD_CURVE_POINTS; i++)
+  {
+    CHECK_EQ(curveExpo(i, 0, 100), i * 1024U);
+    CHECK_EQ(curveExpo(i, 100, 100), i * i * i);
+  }
+
+  // rates above 100 saturate before full deflection
+  CHECK_EQ(curveExpo(16, 0, 200), 32768);
+  CHECK_EQ(curveExpo(15, 0, 200), 30720);
+  checkCurve([](uint8_t i) { return(curveExpo(i, 40, 200)); }, 32768);
+}
+
+static void testS(void)
+{
+  for (uint8_t s = 0; s <= 100; s += 5)
+    checkCurve([=](uint8_t i) { return(curveS(i, s, 100)); }, 32768);
+
+  // the S curve is flat at both ends, steep in the middle and passes through
+  // the center of the range
+  CHECK(curveS(1, 100, 100) < 1024 / 8);
+  CHECK(32768 - curveS(31, 100, 100) < 1024 / 8);
+  CHECK(curveS(17, 100, 100) - curveS(15, 100, 100) > 2048 * 5 / 4);
+  CHECK_EQ(curveS(16, 100, 100), 16384);
+
+  // and S 0 is linear
+  for (uint8_t i = 0; i < GAMEPAD_CURVE_POINTS; i++)
+    CHECK_EQ(curveS(i, 0, 100), i * 1024U);
+}
+
+static void testTable(void)
+{
+  // the tables hold the curve function values
+  for (uint8_t i = 0; i < GAMEPAD_CURVE_POINTS; i++)
+  {
+    CHECK_EQ(pgm_read_word(&curveSoft[i]), curveExpo(i, 40, 100));
+    CHECK_EQ(pgm_read_word(&curveHalf[i]), curveExpo(i, 40, 50));
+    CHECK_EQ(pgm_read_word(&curveSmooth[i]), curveS(i, 100, 100));
+  }
+}
+
+static void testLinear(void)
+{
+  MD_GamepadCurve c;
+
+  // no curve leaves the value unchanged, even beyond full deflection
+  c.begin(1000);
+  CHECK_EQ(c.apply(0), 0);
+  CHECK_EQ(c.apply(-700), -700);
+  CHECK_EQ(c.apply(INT16_MAX), INT16_MAX);
+
+  // the linear curve follows the input over the whole range, to within the
+  // 1/256 interval resolution of the table position
+  c.setTable(curveLinear);
+  for (uint8_t r = 0; r < ARRAY_SIZE(ranges); r++)
+  {
+    int16_t full = ranges[r];
+    int16_t errMax = 0;
+
+    c.setRange(full);
+    for (int32_t v = 0; v <= full; v += (full > 1024 ? 7 : 1))
+    {
+      int16_t err = c.apply(v) - v;
+
+      if (err > errMax) errMax = err;
+      if (-err > errMax) errMax = -err;
+    }
+    CHECK(errMax <= 1 + full / (256 * (GAMEPAD_CURVE_POINTS - 1)));
+    CHECK_EQ(c.apply(full), full);
+    CHECK_EQ(c.apply(-full), -full);
+  }
+}
+
+static void testApply(void)
+{
+  MD_GamepadCurve c;
+
+  for (uint8_t t = 0; t < ARRAY_SIZE(tables); t++)
+  {
+    c.begin(1000);
+    c.setTable(tables[t]);
+
+    for (uint8_t r = 0; r < ARRAY_SIZE(ranges); r++)
+    {
+      int16_t full = ranges[r];
+      int16_t last = ((uint32_t)pgm_read_word(&tables[t][GAMEPAD_CURVE_POINTS - 1]) * full + 0x4000) >> 15;
+      int16_t prev = 0;
+
+      c.setRange(full);
+
+      // the ends are exact and the output saturates beyond full deflection
+      CHECK_EQ(c.apply(0), 0);
+      CHECK_EQ(c.apply(full), last);
+      CHECK_EQ(c.apply(-full), -last);
+      CHECK_EQ(c.apply(INT16_MAX), last);
+      CHECK_EQ(c.apply(INT16_MIN), -last);
+
+      // the output rises steadily and is mirrored exactly for negative values
+      for (int32_t v = 0; v <= full; v += (full > 1024 ? 7 : 1))
+      {
+        int16_t y = c.apply(v);
+
+        CHECK(y >= prev);
+        CHECK_EQ(c.apply(-v), -y);
+        prev = y;
+      }
+    }
+  }
+}
+
+static void testInterpolate(void)
+{
+  MD_GamepadCurve c;
+
+  // with 1024 full deflection each interval is 32 axis units
+  c.begin(1024);
+  c.setTable(curveSmooth);
+  for (uint8_t i = 0; i < GAMEPAD_CURVE_POINTS - 1; i++)
+  {
+    int32_t y0 = pgm_read_word(&curveSmooth[i]);
+    int32_t y1 = pgm_read_word(&curveSmooth[i + 1]);
+
+    // the table points are exact
+    CHECK_EQ(c.apply(32 * i), (y0 + 16) / 32);
+
+    // and the values between them are on the straight line joining them
+    for (uint8_t f = 1; f < 32; f++)
+    {
+      int32_t y = (32 * y0 + f * (y1 - y0) + 512) / 1024;
+      int16_t err = c.apply(32 * i + f) - y;
+
+      CHECK(err >= -1 && err <= 1);
+    }
+  }
+
+  // the table in use can be changed at any time
+  CHECK_EQ(c.apply(512), 512);
+  c.setTable(curveCubic);
+  CHECK_EQ(c.apply(512), 128);
+  c.setTable(curveHalf);
+  CHECK_EQ(c.apply(1024), 512);
+  c.setTable(nullptr);
+  CHECK_EQ(c.apply(512), 512);
+}
+
+int main(void)
+{
+  RUN(testExpo);
+  RUN(testS);
+  RUN(testTable);
+  RUN(testLinear);
+  RUN(testApply);
+  RUN(testInterpolate);
+
+  return(testResult());
+}
@@ -0,0 +1,131 @@
+// Unit tests for the MD_Gamepad joystick axis filters
+//
+// Covers the step response of each filter in MD_Gamepad_Filter.h, the spike
+// rejection of the median filter and the adaptive smoothing of the One Euro
+// filter, including full scale steps where the intermediate values need 32 bits.
+//
+// Build and run all the tests from the library folder with
+//   make -C extras/host check
+//
+#include <MD_Gamepad_Filter.h>
+#include "MD_GamepadTest.h"
+
+// Filter n samples of x at 1ms, returning the last output. The outputs must
+// move monotonically towards x, so a wrapped intermediate value fails the test.
+template <class F>
+static int16_t step(F &f, int16_t x, uint16_t n)
+{
+  int16_t y = f.filter(x, 1);
+
+  for (uint16_t i = 1; i < n; i++)
+  {
+    int16_t y1 = f.filter(x, 1);
+
+    CHECK(x >= y ? (y1 >= y && y1 <= x) : (y1 <= y && y1 >= x));
+    y = y1;
+  }
+
+  return(y);
+}
+
+static void testEMA(void)
+{
+  MD_GamepadFilterEMA<2> f;
+
+  // each sample moves a quarter of the way and converges on a step
+  f.reset(0);
+  CHECK_EQ(f.filter(1000, 1), 250);
+  CHECK_EQ(f.filter(1000, 1), 438);
+  CHECK_EQ(step(f, 1000, 40), 1000);
+
+  // and back, with the fractional bits rounded
+  CHECK_EQ(step(f, -1000, 50), -1000);
+
+  // a full scale negative step
+  f.reset(INT16_MAX);
+  CHECK_EQ(step(f, INT16_MIN, 60), INT16_MIN);
+  f.reset(INT16_MIN);
+  CHECK_EQ(step(f, INT16_MAX, 60), INT16_MAX);
+}
+
+static void testMedian3(void)
+{
+  MD_GamepadFilterMedian3 f;
+  const int16_t spike[] = { 100, 100, 5000, 100, 100, -5000, 100, 100 };
+
+  // single sample spikes are removed
+  f.reset(100);
+  for (uint8_t i = 0; i < sizeof(spike) / sizeof(spike[0]); i++)
+    CHECK_EQ(f.filter(spike[i], 1), 100);
+
+  // a step is followed after one sample
+  CHECK_EQ(f.filter(500, 1), 100);
+  CHECK_EQ(f.filter(500, 1), 500);
+  CHECK_EQ(f.filter(500, 1), 500);
+
+  // a full scale negative step
+  f.reset(INT16_MAX);
+  CHECK_EQ(f.filter(INT16_MIN, 1), INT16_MAX);
+  CHECK_EQ(f.filter(INT16_MIN, 1), INT16_MIN);
+}
+
+static void testOneEuro(void)
+{
+  MD_GamepadFilterOneEuro<> f;
+  int16_t yMax = 0;
+
+  // noise at rest is smoothed heavily
+  f.reset(0);
+  for (uint16_t i = 0; i < 1000; i++)
+  {
+    int16_t y = f.filter(i & 1 ? 20 : -20, 1);
+
+    if (y > yMax) yMax = y;
+    if (-y > yMax) yMax = -y;
+  }
+  CHECK(yMax <= 2);
+
+  // a fast step is followed with little lag
+  f.reset(0);
+  CHECK(f.filter(10000, 1) >= 7000);
+  CHECK(step(f, 10000, 4) >= 9900);
+
+  // a full scale negative step, where the input step needs 17 bits
+  f.reset(INT16_MAX);
+  CHECK(f.filter(INT16_MIN, 1) < -15000);
+  CHECK(step(f, INT16_MIN, 10) <= INT16_MIN + 10);
+  f.reset(INT16_MIN);
+  CHECK(f.filter(INT16_MAX, 1) > 15000);
+  CHECK(step(f, INT16_MAX, 10) >= INT16_MAX - 10);
+
+  // a slow movement is still followed at rest cutoff
+  f.reset(0);
+  CHECK(step(f, 100, 2000) >= 99);
+}
+
+static void testChain(void)
+{
+  MD_GamepadFilterChain<MD_GamepadFilterMedian3, MD_GamepadFilterEMA<1> > f;
+
+  // the spike is removed before the average
+  f.reset(0);
+  CHECK_EQ(f.filter(0, 1), 0);
+  CHECK_EQ(f.filter(8000, 1), 0);
+  CHECK_EQ(f.filter(0, 1), 0);
+  CHECK_EQ(f.filter(0, 1), 0);
+
+  // and a step is delayed one sample, then averaged
+  CHECK_EQ(f.filter(1000, 1), 0);
+  CHECK_EQ(f.filter(1000, 1), 500);
+  CHECK_EQ(f.filter(1000, 1), 750);
+}
+
+int main(void)
+{
+  RUN(testEMA);
+  RUN(testMedian3);
+  RUN(testOneEuro);
+  RUN(testChain);
+
+  return(testResult());
+}
@@ -0,0 +1,162 @@
+// Unit tests for the GAMEPAD_PCINT switch edge capture
+//
+// MD_GamepadHAL::setSwitch() calls the pin change interrupt handlers as the
+// target would. The gamepad uses its own clock, separate from the simulated
+// Arduino clock, to check the edge timestamps are taken from the Clock
+// template parameter.
+//
+#define GAMEPAD_PCINT 1
+#include <MD_Gamepad.h>
+#include "MD_GamepadTest.h"
+
+// Clock stepped by the tests, in microseconds
+struct TestClock
+{
+  static uint32_t now;
+  static inline uint32_t millis(void) { return(now / 1000); }
+  static inline uint32_t micros(void) { return(now); }
+};
+
+uint32_t TestClock::now;
+
+typedef MD_GamepadT<MD_GamepadShield, TestClock> MD_GamepadTest;
+
+static void start(MD_GamepadTest &pad)
+{
+  MD_GamepadHAL::reset();
+  TestClock::now = 0;
+  pad.begin();
+  MD_GamepadHAL::clearCount();
+}
+
+// Call update() every millisecond for ms milliseconds
+static void runFor(MD_GamepadTest &pad, uint32_t ms)
+{
+  for (uint32_t i = 0; i < ms; i++)
+  {
+    TestClock::now += 1000;
+    pad.update();
+  }
+}
+
+// Check the next edge
+static void checkEdge(MD_GamepadTest &pad, uint8_t sw, bool pressed, uint32_t time)
+{
+  MD_GamepadEvent e = MD_GamepadEvent();
+
+  CHECK(pad.getEdge(e));
+  CHECK_EQ(e.id, sw);
+  CHECK_EQ(e.type, pressed ? MD_GamepadEvent::EV_PRESS : MD_GamepadEvent::EV_RELEASE);
+  CHECK_EQ(e.time, time);
+}
+
+static void testBegin(void)
+{
+  MD_GamepadTest pad{};
+  MD_GamepadEvent e;
+
+  start(pad);
+  CHECK_EQ(PCICR, _BV(PCIE2) | _BV(PCIE0));
+  CHECK_EQ(PCMSK2, 0xfc);
+  CHECK_EQ(PCMSK0, 0x01);
+  CHECK(!pad.getEdge(e));
+}
+
+static void testEdges(void)
+{
+  MD_GamepadTest pad{};
+  MD_GamepadEvent e;
+
+  start(pad);
+
+  // each edge is queued with the time it happened, on port D and port B
+  TestClock::now = 1234567;
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_C, true);
+  TestClock::now += 250;
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_K, true);
+  TestClock::now += 3;
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_C, false);
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_C, false);   // no change, no edge
+  TestClock::now += 1000000;
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_K, false);
+
+  checkEdge(pad, MD_Gamepad::SW_C, true, 1234567);
+  checkEdge(pad, MD_Gamepad::SW_K, true, 1234817);
+  checkEdge(pad, MD_Gamepad::SW_C, false, 1234820);
+  checkEdge(pad, MD_Gamepad::SW_K, false, 2234820);
+  CHECK(!pad.getEdge(e));
+
+  // every switch
+  for (uint8_t sw = MD_Gamepad::SW_A; sw <= MD_Gamepad::SW_F; sw++)
+  {
+    TestClock::now += 10;
+    MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_A + sw - MD_Gamepad::SW_A, true);
+    checkEdge(pad, sw, true, TestClock::now);
+  }
+  CHECK(!pad.getEdge(e));
+
+  // the time comes from the clock, not the Arduino micros()
+  CHECK_EQ(MD_GamepadHAL::count.micros, 0);
+}
+
+static void testBounce(void)
+{
+  MD_GamepadTest pad{};
+  MD_GamepadEvent e;
+
+  start(pad);
+
+  // every bounce is an edge, and the debounced state only changes once
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    TestClock::now += 100;
+    MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_B, true);
+    TestClock::now += 100;
+    MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_B, false);
+  }
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_B, true);
+  for (uint8_t i = 0; i < 7; i++)
+    CHECK(pad.getEdge(e) && e.id == MD_Gamepad::SW_B);
+  CHECK(!pad.getEdge(e));
+
+  runFor(pad, 30);
+  CHECK_EQ(pad.getState(), MD_Gamepad::swBit(MD_Gamepad::SW_B));
+  CHECK_EQ(MD_GamepadHAL::count.micros, 0);
+}
+
+static void testIdle(void)
+{
+  MD_GamepadTest pad{};
+
+  // the switches are scanned after begin() until the debounce has settled
+  start(pad);
+  runFor(pad, 50);
+  MD_GamepadHAL::clearCount();
+
+  // and then not at all while there are no edges
+  runFor(pad, 1000);
+  CHECK_EQ(MD_GamepadHAL::count.digitalRead, 0);
+  CHECK_EQ(MD_GamepadHAL::count.portRead, 0);
+
+  // an edge restarts the scans until the switch is debounced
+  MD_GamepadHAL::setSwitch(MD_GamepadShield::PIN_E, true);
+  MD_GamepadHAL::clearCount();
+  runFor(pad, 50);
+  CHECK(MD_GamepadHAL::count.digitalRead > 0);
+  CHECK_EQ(pad.getState(), MD_Gamepad::swBit(MD_Gamepad::SW_E));
+
+  MD_GamepadHAL::clearCount();
+  runFor(pad, 1000);
+  CHECK_EQ(MD_GamepadHAL::count.digitalRead, 0);
+  CHECK_EQ(pad.getState(), MD_Gamepad::swBit(MD_Gamepad::SW_E));
+}
+
+int main(void)
+{
+  RUN(testBegin);
+  RUN(testEdges);
+  RUN(testBounce);
+  RUN(testIdle);
+
+  return(testResult());
+}
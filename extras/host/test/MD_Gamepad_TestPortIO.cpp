@@ -0,0 +1,210 @@
+// Unit tests for the GAMEPAD_PORT_IO switch reads
+//
+// A gamepad with the shield pin layout reads the switches from the PIND and
+// PINB registers. Other layouts with the switches on D0-D13 and A0-A5 read each
+// port they use once, and a layout with a switch on an analog only pin falls
+// back to digitalRead(). All are run side by side on the same switch presses,
+// checking they see the same switches and counting the hardware accesses each
+// makes.
+//
+#define GAMEPAD_PORT_IO 1
+#include <MD_Gamepad.h>
+#include "MD_GamepadTest.h"
+
+// Switches on D9-D13 and A2-A3, read from PINB and PINC
+struct AltLayout : MD_GamepadShield
+{
+  enum
+  {
+    PIN_A = 9,
+    PIN_B = 10,
+    PIN_C = 11,
+    PIN_D = 12,
+    PIN_E = 13,
+    PIN_F = A2,
+    PIN_K = A3,
+  };
+};
+
+// Switches spread over all three ports, read from PIND, PINB and PINC. The pins
+// shared with the other layouts are for the same switches.
+struct MixedLayout : MD_GamepadShield
+{
+  enum
+  {
+    PIN_A = 2,
+    PIN_B = 10,
+    PIN_C = 4,
+    PIN_D = A4,
+    PIN_E = 13,
+    PIN_F = A2,
+    PIN_K = 0,
+  };
+};
+
+// Switch K on the analog only pin A6, so the switches cannot be read from the ports
+struct AnalogLayout : MD_GamepadShield
+{
+  enum
+  {
+    PIN_A = AltLayout::PIN_A,
+    PIN_B = AltLayout::PIN_B,
+    PIN_C = AltLayout::PIN_C,
+    PIN_D = AltLayout::PIN_D,
+    PIN_E = AltLayout::PIN_E,
+    PIN_F = AltLayout::PIN_F,
+    PIN_K = A6,
+  };
+};
+
+typedef MD_GamepadT<AltLayout> MD_GamepadAlt;
+typedef MD_GamepadT<MixedLayout> MD_GamepadMixed;
+typedef MD_GamepadT<AnalogLayout> MD_GamepadAnalog;
+
+// Pins for each switch in each layout, SW_A to SW_K
+template <class C> struct pins_t
+{
+  static constexpr uint8_t pin[] = { C::PIN_A, C::PIN_B, C::PIN_C, C::PIN_D, C::PIN_E, C::PIN_F, C::PIN_K };
+};
+template <class C> constexpr uint8_t pins_t<C>::pin[];
+
+// Hardware accesses made by the updates of each gamepad
+struct reads_t
+{
+  uint32_t digitalRead;
+  uint32_t portRead;
+};
+
+static reads_t shieldReads, altReads, mixedReads, analogReads;
+
+// The gamepads under test, one for each layout
+struct pads_t
+{
+  MD_Gamepad shield;
+  MD_GamepadAlt alt;
+  MD_GamepadMixed mixed;
+  MD_GamepadAnalog analog;
+};
+
+// Press or release a switch in all the layouts
+static void setSwitch(uint8_t sw, bool pressed)
+{
+  uint8_t i = sw - MD_Gamepad::SW_A;
+
+  MD_GamepadHAL::setSwitch(pins_t<MD_GamepadShield>::pin[i], pressed);
+  MD_GamepadHAL::setSwitch(pins_t<AltLayout>::pin[i], pressed);
+  MD_GamepadHAL::setSwitch(pins_t<MixedLayout>::pin[i], pressed);
+  MD_GamepadHAL::setSwitch(pins_t<AnalogLayout>::pin[i], pressed);
+}
+
+// Update one gamepad, adding up its accesses
+template <class T>
+static void update(T &pad, reads_t &reads)
+{
+  MD_GamepadHAL::clearCount();
+  pad.update();
+  reads.digitalRead += MD_GamepadHAL::count.digitalRead;
+  reads.portRead += MD_GamepadHAL::count.portRead;
+}
+
+// Advance the time 1ms and update all the gamepads
+static void update(pads_t &p)
+{
+  MD_GamepadHAL::advance(1);
+  update(p.shield, shieldReads);
+  update(p.alt, altReads);
+  update(p.mixed, mixedReads);
+  update(p.analog, analogReads);
+}
+
+static void start(pads_t &p)
+{
+  MD_GamepadHAL::reset();
+  p.shield.begin();
+  p.alt.begin();
+  p.mixed.begin();
+  p.analog.begin();
+  p.shield.setDebounceDelay(1);
+  p.alt.setDebounceDelay(1);
+  p.mixed.setDebounceDelay(1);
+  p.analog.setDebounceDelay(1);
+  shieldReads = altReads = mixedReads = analogReads = reads_t();
+}
+
+static void testScanCount(void)
+{
+  pads_t p{};
+
+  // 2 port reads per scan for the shield and for D9-D13 and A2-A3, 3 when all
+  // the ports are used, and 7 digitalRead() with a switch on an analog only pin
+  start(p);
+  update(p);
+  CHECK_EQ(shieldReads.digitalRead, 0);
+  CHECK_EQ(shieldReads.portRead, 2);
+  CHECK_EQ(altReads.digitalRead, 0);
+  CHECK_EQ(altReads.portRead, 2);
+  CHECK_EQ(mixedReads.digitalRead, 0);
+  CHECK_EQ(mixedReads.portRead, 3);
+  CHECK_EQ(analogReads.digitalRead, 7);
+  CHECK_EQ(analogReads.portRead, 0);
+
+  shieldReads = altReads = mixedReads = analogReads = reads_t();
+  for (uint16_t i = 0; i < 100; i++)
+    update(p);
+  CHECK_EQ(shieldReads.portRead, 2 * 100);
+  CHECK_EQ(altReads.portRead, 2 * 100);
+  CHECK_EQ(mixedReads.portRead, 3 * 100);
+  CHECK_EQ(analogReads.digitalRead, 7 * 100);
+  CHECK_EQ(shieldReads.digitalRead + altReads.digitalRead + mixedReads.digitalRead + analogReads.portRead, 0);
+
+  // the modeled cost of one scan
+  const MD_GamepadHAL::cost_t &cost = MD_GamepadHAL::cost;
+
+  MD_GamepadHAL::clearCount();
+  MD_GamepadHAL::advance(1);
+  p.shield.update();
+  CHECK_EQ(MD_GamepadHAL::count.cycles, cost.millis + 2 * cost.portRead);
+  MD_GamepadHAL::clearCount();
+  p.alt.update();
+  CHECK_EQ(MD_GamepadHAL::count.cycles, cost.millis + 2 * cost.portRead);
+  MD_GamepadHAL::clearCount();
+  p.analog.update();
+  CHECK_EQ(MD_GamepadHAL::count.cycles, cost.millis + 7 * cost.digitalRead);
+}
+
+static void testSameSwitches(void)
+{
+  pads_t p{};
+  uint16_t mismatch = 0;
+
+  start(p);
+
+  // each switch alone, then every combination of switches
+  for (uint16_t combo = 1; combo < (1 << 7) + 7; combo++)
+  {
+    uint8_t set = (combo <= 7 ? 1 << (combo - 1) : combo - 7);
+
+    for (uint8_t sw = MD_Gamepad::SW_A; sw <= MD_Gamepad::SW_K; sw++)
+      setSwitch(sw, set & (1 << (sw - MD_Gamepad::SW_A)));
+    for (uint8_t i = 0; i < 100; i++)
+    {
+      update(p);
+      if (p.shield.getState() != p.alt.getState() || p.shield.getSwitch() != p.alt.getSwitch() ||
+          p.shield.getState() != p.mixed.getState() || p.shield.getSwitch() != p.mixed.getSwitch() ||
+          p.shield.getState() != p.analog.getState() || p.shield.getSwitch() != p.analog.getSwitch())
+        mismatch++;
+    }
+    CHECK_EQ(p.shield.getState(), set << MD_Gamepad::SW_A);
+  }
+  CHECK_EQ(mismatch, 0);
+  CHECK_EQ(shieldReads.digitalRead + altReads.digitalRead + mixedReads.digitalRead, 0);
+  CHECK_EQ(analogReads.portRead, 0);
+}
+
+int main(void)
+{
+  RUN(testScanCount);
+  RUN(testSameSwitches);
+
+  return(testResult());
+}
@@ -0,0 +1,190 @@
+// Unit tests for the MD_Gamepad event queue
+//
+// Covers the order and index wrap of MD_GamepadQueue in MD_Gamepad_Queue.h and
+// each of its overflow behaviors, with the count of the items lost.
+//
+// Build and run all the tests from the library folder with
+//   make -C extras/host check
+//
+#include <MD_Gamepad.h>
+#include "MD_GamepadTest.h"
+
+// The queue under test holds 7 events
+typedef MD_GamepadQueue<MD_GamepadEvent, 8> queue_t;
+
+// An event numbered i
+static MD_GamepadEvent ev(uint16_t i)
+{
+  MD_GamepadEvent e = MD_GamepadEvent();
+
+  e.time = 1000 + i;
+  e.type = MD_GamepadEvent::EV_PRESS;
+  e.id = i & 0xff;
+  e.value = i;
+
+  return(e);
+}
+
+// Push events first to last, returning the number queued
+static uint16_t pushAll(queue_t &q, uint16_t first, uint16_t last)
+{
+  uint16_t n = 0;
+
+  for (uint16_t i = first; i <= last; i++)
+    if (q.push(ev(i)))
+      n++;
+
+  return(n);
+}
+
+// Check the next events popped are first to last
+static void popAll(queue_t &q, uint16_t first, uint16_t last)
+{
+  MD_GamepadEvent e = MD_GamepadEvent();
+
+  for (uint16_t i = first; i <= last; i++)
+  {
+    CHECK(q.pop(e));
+    CHECK_EQ(e.type, MD_GamepadEvent::EV_PRESS);
+    CHECK_EQ(e.value, i);
+  }
+}
+
+static void testOrder(void)
+{
+  queue_t q;
+  MD_GamepadEvent e = MD_GamepadEvent();
+
+  // items come out in order, across many wraps of the 8 bit indices
+  CHECK(!q.pop(e));
+  for (uint16_t i = 0; i < 1000; i += 5)
+  {
+    CHECK_EQ(pushAll(q, i, i + 4), 5);
+    CHECK_EQ(q.count(), 5);
+    popAll(q, i, i + 4);
+    CHECK(!q.pop(e));
+  }
+  CHECK_EQ(q.dropped(), 0);
+
+  // one slot is kept free
+  CHECK_EQ(pushAll(q, 0, 6), 7);
+  CHECK_EQ(q.count(), 7);
+  CHECK(!q.push(ev(7)));
+}
+
+static void testDropNewest(void)
+{
+  queue_t q;
+  MD_GamepadEvent e = MD_GamepadEvent();
+
+  // the items after the queue is full are dropped and counted
+  CHECK_EQ(pushAll(q, 0, 9), 7);
+  CHECK_EQ(q.dropped(), 3);
+  popAll(q, 0, 6);
+  CHECK(!q.pop(e));
+
+  // and the queue works normally once there is space
+  CHECK_EQ(pushAll(q, 10, 11), 2);
+  popAll(q, 10, 11);
+  CHECK_EQ(q.dropped(), 3);
+
+  q.clear();
+  CHECK_EQ(q.dropped(), 0);
+}
+
+static void testDropOldest(void)
+{
+  queue_t q;
+  MD_GamepadEvent e = MD_GamepadEvent();
+
+  // every item is queued, overwriting the oldest, and the newest are kept
+  q.setOverflow(queue_t::DROP_OLDEST);
+  CHECK_EQ(pushAll(q, 0, 19), 20);
+  CHECK_EQ(q.count(), 7);
+  popAll(q, 13, 19);
+  CHECK(!q.pop(e));
+
+  // the overwritten items are counted when the consumer skips them
+  CHECK_EQ(q.dropped(), 13);
+
+  // a queue that is just full loses nothing
+  CHECK_EQ(pushAll(q, 20, 26), 7);
+  popAll(q, 20, 26);
+  CHECK_EQ(q.dropped(), 13);
+
+  // and one more overwrites only the oldest
+  CHECK_EQ(pushAll(q, 27, 34), 8);
+  popAll(q, 28, 34);
+  CHECK_EQ(q.dropped(), 14);
+}
+
+static void testCoalesce(void)
+{
+  queue_t q;
+  MD_GamepadEvent e = MD_GamepadEvent();
+
+  // the items after the queue is full are merged into one pending EV_SYNC
+  // event, and each of them is counted
+  q.setOverflow(queue_t::COALESCE);
+  CHECK_EQ(pushAll(q, 0, 9), 7);
+  CHECK_EQ(q.dropped(), 3);
+  CHECK(!q.flush());
+
+  // the pending event is queued once there is space
+  popAll(q, 0, 0);
+  CHECK(q.flush());
+  popAll(q, 1, 6);
+  CHECK(q.pop(e));
+  CHECK_EQ(e.type, MD_GamepadEvent::EV_SYNC);
+  CHECK_EQ(e.value, 3);
+  CHECK_EQ(e.time, ev(9).time);
+  CHECK(!q.pop(e));
+  CHECK_EQ(q.dropped(), 3);
+
+  // a push queues the pending event before the new item, which is merged
+  // into a new pending event if the queue is still full
+  CHECK_EQ(pushAll(q, 10, 17), 7);
+  popAll(q, 10, 10);
+  CHECK(!q.push(ev(18)));
+  CHECK_EQ(q.dropped(), 5);
+  popAll(q, 11, 16);
+  CHECK(q.pop(e));
+  CHECK_EQ(e.type, MD_GamepadEvent::EV_SYNC);
+  CHECK_EQ(e.value, 1);
+  CHECK(!q.pop(e));
+  CHECK(q.flush());
+  CHECK(q.pop(e));
+  CHECK_EQ(e.type, MD_GamepadEvent::EV_SYNC);
+  CHECK_EQ(e.value, 1);
+  CHECK_EQ(e.time, ev(18).time);
+  CHECK(!q.pop(e));
+
+  // and the queue works normally once the pending event is delivered
+  CHECK_EQ(pushAll(q, 20, 21), 2);
+  popAll(q, 20, 21);
+  CHECK_EQ(q.dropped(), 5);
+}
+
+static void testNone(void)
+{
+  MD_GamepadQueueNone q;
+  MD_GamepadEvent e = MD_GamepadEvent();
+
+  // every item is discarded without being counted
+  CHECK(!q.push(ev(0)));
+  CHECK(!q.pop(e));
+  CHECK(q.flush());
+  CHECK_EQ(q.count(), 0);
+  CHECK_EQ(q.dropped(), 0);
+}
+
+int main(void)
+{
+  RUN(testOrder);
+  RUN(testDropNewest);
+  RUN(testDropOldest);
+  RUN(testCoalesce);
+  RUN(testNone);
+
+  return(testResult());
+}
@@ -0,0 +1,312 @@
+// Unit tests for the MD_Gamepad two dimensional joystick conditioning
+//
+// Covers the radial deadzone, anti-deadzone, outer saturation and circle to
+// square mapping of MD_GamepadStick in MD_Gamepad_Stick.h, its integer square
+// root and arctangent, and the direction quantizer MD_GamepadSector.
+//
+// Build and run all the tests from the library folder with
+//   make -C extras/host check
+//
+#include <math.h>
+#include <MD_Gamepad.h>
+#include "MD_GamepadTest.h"
+
+// Angle in degrees to binary angle units
+static uint16_t bau(double deg) { return((uint16_t)(int32_t)lround(deg * 65536.0 / 360.0)); }
+
+// Condition a position, returning the result in x and y
+static void apply(const MD_GamepadStick &s, int16_t &x, int16_t &y, int16_t x0, int16_t y0)
+{
+  x = x0;
+  y = y0;
+  s.apply(x, y);
+}
+
+static void testDeadzone(void)
+{
+  MD_GamepadStick s;
+  int16_t x, y;
+
+  s.begin(1000);
+  s.set(10, 90, 0);
+
+  // a diagonal inside the inner radius is centered, in every quadrant
+  apply(s, x, y, 70, 70);
+  CHECK_EQ(x, 0); CHECK_EQ(y, 0);
+  apply(s, x, y, -70, 70);
+  CHECK_EQ(x, 0); CHECK_EQ(y, 0);
+  apply(s, x, y, -70, -70);
+  CHECK_EQ(x, 0); CHECK_EQ(y, 0);
+
+  // and so is a position on the inner radius
+  apply(s, x, y, 100, 0);
+  CHECK_EQ(x, 0); CHECK_EQ(y, 0);
+
+  // the output rises from 0 outside the inner radius, keeping the direction
+  apply(s, x, y, 110, 0);
+  CHECK(x > 0 && x < 20);
+  CHECK_EQ(y, 0);
+  apply(s, x, y, 0, -110);
+  CHECK_EQ(x, 0);
+  CHECK(y < 0 && y > -20);
+
+  // and rises steadily to the outer radius
+  int16_t prev = 0;
+
+  for (int16_t r = 101; r <= 900; r++)
+  {
+    apply(s, x, y, r, 0);
+    CHECK(x >= prev);
+    prev = x;
+  }
+}
+
+static void testSaturation(void)
+{
+  MD_GamepadStick s;
+  int16_t x, y;
+
+  s.begin(1000);
+  s.set(10, 90, 0);
+
+  // the outer radius gives exactly full scale on each axis
+  apply(s, x, y, 900, 0);
+  CHECK_EQ(x, 1000); CHECK_EQ(y, 0);
+  apply(s, x, y, 0, -900);
+  CHECK_EQ(x, 0); CHECK_EQ(y, -1000);
+
+  // and beyond it
+  apply(s, x, y, -1000, 0);
+  CHECK_EQ(x, -1000); CHECK_EQ(y, 0);
+
+  // a diagonal at the outer radius is on the full scale circle
+  apply(s, x, y, 637, 637);
+  CHECK(x >= 706 && x <= 708);
+  CHECK_EQ(x, y);
+
+  // full scale is reached with small ranges, where rounding matters
+  s.begin(127);
+  s.set(10, 100, 0);
+  apply(s, x, y, 127, 0);
+  CHECK_EQ(x, 127);
+  apply(s, x, y, 0, -127);
+  CHECK_EQ(y, -127);
+}
+
+static void testAntiDeadzone(void)
+{
+  MD_GamepadStick s;
+  int16_t x, y;
+
+  s.begin(1000);
+  s.set(10, 100, 20);
+
+  // the output jumps to the anti-deadzone radius outside the inner radius
+  apply(s, x, y, 100, 0);
+  CHECK_EQ(x, 0);
+  apply(s, x, y, 101, 0);
+  CHECK(x >= 200 && x <= 202);
+
+  // and still reaches full scale
+  apply(s, x, y, 1000, 0);
+  CHECK_EQ(x, 1000);
+}
+
+static void testSquare(void)
+{
+  MD_GamepadStick s;
+  int16_t x, y;
+
+  s.begin(1000);
+  s.set(10, 100, 0);
+
+  // without the mapping a corner is on the full scale circle
+  apply(s, x, y, 1000, 1000);
+  CHECK(x >= 706 && x <= 708);
+  CHECK_EQ(x, y);
+
+  // with it the corners reach full scale on both axes
+  s.setSquare(true);
+  apply(s, x, y, 1000, 1000);
+  CHECK_EQ(x, 1000); CHECK_EQ(y, 1000);
+  apply(s, x, y, -1000, 1000);
+  CHECK_EQ(x, -1000); CHECK_EQ(y, 1000);
+  apply(s, x, y, -1000, -1000);
+  CHECK_EQ(x, -1000); CHECK_EQ(y, -1000);
+
+  // and the axes are unchanged
+  apply(s, x, y, 1000, 0);
+  CHECK_EQ(x, 1000); CHECK_EQ(y, 0);
+}
+
+static void testSymmetry(void)
+{
+  MD_GamepadStick s;
+
+  s.begin(32767);
+  s.set(8, 95, 5);
+
+  // mirroring the input mirrors the output exactly, with or without the mapping
+  for (uint8_t sq = 0; sq < 2; sq++)
+  {
+    s.setSquare(sq != 0);
+    for (int32_t x0 = 0; x0 <= 32767; x0 += 1489)
+      for (int32_t y0 = 0; y0 <= 32767; y0 += 1777)
+      {
+        int16_t x, y, xn, yn;
+
+        apply(s, x, y, x0, y0);
+        apply(s, xn, yn, -x0, -y0);
+        CHECK(xn == -x && yn == -y);
+        apply(s, xn, yn, -x0, y0);
+        CHECK(xn == -x && yn == y);
+        apply(s, xn, yn, x0, -y0);
+        CHECK(xn == x && yn == -y);
+        CHECK(x >= 0 && y >= 0);
+      }
+  }
+
+  // the most negative axis value is full scale
+  int16_t x, y;
+
+  apply(s, x, y, INT16_MIN, 0);
+  CHECK_EQ(x, -32767); CHECK_EQ(y, 0);
+}
+
+static void testIsqrt(void)
+{
+  // exhaustive for small values, where the rounding down shows
+  for (uint32_t v = 0; v < 70000; v++)
+  {
+    uint32_t r = MD_GamepadStick::isqrt(v);
+
+    if (!(r * r <= v && (r + 1) * (r + 1) > v))
+    {
+      CHECK_EQ(r, v);
+      break;
+    }
+  }
+
+  // around the squares up to the largest result
+  for (uint32_t r = 1; r < 0x10000; r += 97)
+  {
+    CHECK_EQ(MD_GamepadStick::isqrt(r * r), r);
+    CHECK_EQ(MD_GamepadStick::isqrt(r * r - 1), r - 1);
+  }
+  CHECK_EQ(MD_GamepadStick::isqrt(0xfffe0001UL), 0xffff);
+  CHECK_EQ(MD_GamepadStick::isqrt(0xffffffffUL), 0xffff);
+
+  // the largest joystick magnitude
+  CHECK_EQ(MD_GamepadStick::isqrt(2UL * 32768 * 32768), 46340);
+}
+
+static void testAtan2(void)
+{
+  // the axes are exact
+  CHECK_EQ(MD_GamepadStick::atan2(0, 0), 0);
+  CHECK_EQ(MD_GamepadStick::atan2(0, 100), 0x0000);
+  CHECK_EQ(MD_GamepadStick::atan2(100, 0), 0x4000);
+  CHECK_EQ(MD_GamepadStick::atan2(0, -100), 0x8000);
+  CHECK_EQ(MD_GamepadStick::atan2(-100, 0), 0xc000);
+  CHECK_EQ(MD_GamepadStick::atan2(0, INT16_MIN), 0x8000);
+  CHECK_EQ(MD_GamepadStick::atan2(INT16_MIN, 0), 0xc000);
+
+  // the diagonals are within 1 and mirror each other
+  uint16_t a = MD_GamepadStick::atan2(100, 100);
+
+  CHECK(a >= 0x2000 - 1 && a <= 0x2000 + 1);
+  CHECK_EQ(MD_GamepadStick::atan2(100, -100), 0x8000 - a);
+  CHECK_EQ(MD_GamepadStick::atan2(-100, -100), 0x8000 + a);
+  CHECK_EQ(MD_GamepadStick::atan2(-100, 100), 0x10000 - a);
+
+  // every octant is within 0.05 degrees, at small and large radii
+  const double radius[] = { 50, 1000, 32767 };
+  int16_t errMax = 0;
+
+  for (uint8_t i = 0; i < sizeof(radius) / sizeof(radius[0]); i++)
+    for (uint16_t tenth = 0; tenth < 3600; tenth++)
+    {
+      double a = tenth * M_PI / 1800;
+      int16_t x = (int16_t)lround(radius[i] * cos(a));
+      int16_t y = (int16_t)lround(radius[i] * sin(a));
+      int16_t err = MD_GamepadStick::atan2(y, x) - bau(atan2((double)y, (double)x) * 180 / M_PI);
+
+      if (err > errMax) errMax = err;
+      if (-err > errMax) errMax = -err;
+    }
+  CHECK(errMax <= bau(0.05));
+}
+
+static void testSector(void)
+{
+  MD_GamepadSector s;
+
+  // 8 ways, sector 0 centered on the positive X axis
+  s.begin(8, 5);
+  CHECK_EQ(s.get(), MD_GamepadSector::CENTER);
+  CHECK_EQ(s.update(bau(0), false), 0);
+  CHECK_EQ(s.update(bau(90), false), 2);
+  CHECK_EQ(s.update(bau(180), false), 4);
+  CHECK_EQ(s.update(bau(270), false), 6);
+  CHECK_EQ(s.update(bau(270), true), MD_GamepadSector::CENTER);
+
+  // leaving the center takes the nearest sector at once
+  CHECK_EQ(s.update(bau(24), false), 1);
+  s.update(0, true);
+  CHECK_EQ(s.update(bau(21), false), 0);
+
+  // the direction only changes past the hysteresis band
+  CHECK_EQ(s.update(bau(27), false), 0);
+  CHECK_EQ(s.update(bau(28), false), 1);
+  CHECK_EQ(s.update(bau(18), false), 1);
+  CHECK_EQ(s.update(bau(17), false), 0);
+
+  // and does not chatter on a boundary
+  for (uint8_t i = 0; i < 20; i++)
+    CHECK_EQ(s.update(bau(i & 1 ? 26 : 19), false), 0);
+
+  // including the boundary across 0
+  CHECK_EQ(s.update(bau(-25), false), 0);
+  CHECK_EQ(s.update(bau(-28), false), 7);
+  CHECK_EQ(s.update(bau(-18), false), 7);
+  CHECK_EQ(s.update(bau(3), false), 0);
+
+  // 4 ways
+  s.setWays(4);
+  CHECK_EQ(s.get(), MD_GamepadSector::CENTER);
+  CHECK_EQ(s.update(bau(44), false), 0);
+  CHECK_EQ(s.update(bau(48), false), 0);
+  CHECK_EQ(s.update(bau(51), false), 1);
+  CHECK_EQ(s.update(bau(180), false), 2);
+  CHECK_EQ(s.update(bau(-40), false), 0);
+  CHECK_EQ(s.update(bau(-49), false), 0);
+  CHECK_EQ(s.update(bau(-51), false), 3);
+
+  // 16 ways, with the band limited to a quarter of the sector
+  s.setWays(16);
+  s.setHysteresis(20);
+  CHECK_EQ(s.update(bau(0), false), 0);
+  CHECK_EQ(s.update(bau(16), false), 0);
+  CHECK_EQ(s.update(bau(17), false), 1);
+  CHECK_EQ(s.update(bau(337.5), false), 15);
+  CHECK_EQ(s.update(bau(350), false), 15);
+  CHECK_EQ(s.update(bau(357), false), 0);
+
+  // other values select 8 ways
+  s.setWays(5);
+  CHECK_EQ(s.update(bau(45), false), 1);
+}
+
+int main(void)
+{
+  RUN(testDeadzone);
+  RUN(testSaturation);
+  RUN(testAntiDeadzone);
+  RUN(testSquare);
+  RUN(testSymmetry);
+  RUN(testIsqrt);
+  RUN(testAtan2);
+  RUN(testSector);
+
+  return(testResult());
+}
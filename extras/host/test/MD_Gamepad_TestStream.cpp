@@ -0,0 +1,293 @@
+// Unit tests for the MD_Gamepad binary state stream
+//
+// Covers the COBS framing, the CRC-8 check, the delta encoding of the fields
+// and the full frame keepalive of MD_GamepadStream in MD_Gamepad_Stream.h.
+//
+// Build and run all the tests from the library folder with
+//   make -C extras/host check
+//
+#include <string.h>
+#include <MD_Gamepad_Stream.h>
+#include "MD_GamepadTest.h"
+
+// Simple repeatable pseudo random numbers
+static uint32_t seed = 1;
+static uint16_t rnd(void) { seed = seed * 1103515245UL + 12345; return(seed >> 16); }
+
+// COBS encode and decode a block, checking the encoded block has no 0x00 bytes
+// and the decoded block is the same as the original
+static void roundTrip(const uint8_t *in, uint8_t len)
+{
+  uint8_t buf[256];
+  uint8_t n = MD_GamepadStream::cobsEncode(in, len, buf);
+
+  CHECK_EQ(n, len + 1);
+  CHECK(memchr(buf, 0, n) == nullptr);
+  CHECK_EQ(MD_GamepadStream::cobsDecode(buf, n), len);
+  CHECK(memcmp(buf, in, len) == 0);
+}
+
+// Encode the state and decode the frame into f, returning the frame flags
+// or 0 if no frame was sent
+static uint8_t send(MD_GamepadStream &s, MD_GamepadStream::frame_t &f, uint32_t now, uint16_t sw, int16_t x, int16_t y)
+{
+  uint8_t buf[MD_GamepadStream::FRAME_MAX];
+  uint8_t n = s.encode(now, sw, x, y);
+
+  if (n == 0)
+    return(0);
+
+  // one delimiter, at the end of the frame
+  CHECK(n <= MD_GamepadStream::FRAME_MAX);
+  CHECK_EQ(s.data()[n - 1], 0);
+  CHECK(memchr(s.data(), 0, n - 1) == nullptr);
+
+  memcpy(buf, s.data(), n - 1);
+  CHECK(MD_GamepadStream::decode(buf, n - 1, f));
+
+  return(f.flags);
+}
+
+static void testCOBS(void)
+{
+  uint8_t in[254] = { 0 };
+
+  // empty and single byte blocks
+  roundTrip(in, 0);
+  in[0] = 0;
+  roundTrip(in, 1);
+  in[0] = 0x55;
+  roundTrip(in, 1);
+
+  // all zero bytes
+  memset(in, 0, sizeof(in));
+  roundTrip(in, sizeof(in));
+
+  // the longest run of non zero bytes, and runs just shorter with a zero at
+  // either end
+  memset(in, 0xa5, sizeof(in));
+  roundTrip(in, sizeof(in));
+  in[0] = 0;
+  roundTrip(in, sizeof(in));
+  in[0] = 0xa5;
+  in[253] = 0;
+  roundTrip(in, sizeof(in));
+  roundTrip(in, 253);
+
+  // random blocks of every length, with many zero bytes
+  for (uint16_t len = 0; len <= sizeof(in); len++)
+    for (uint8_t k = 0; k < 4; k++)
+    {
+      for (uint8_t i = 0; i < len; i++)
+        in[i] = (rnd() & 3) == 0 ? 0 : rnd();
+      roundTrip(in, len);
+    }
+
+  // a zero code or a code past the end is not valid
+  uint8_t bad0[] = { 0x02, 0x11, 0x00, 0x22 };
+  uint8_t bad1[] = { 0x02, 0x11, 0x04, 0x22 };
+
+  CHECK_EQ(MD_GamepadStream::cobsDecode(bad0, sizeof(bad0)), 0);
+  CHECK_EQ(MD_GamepadStream::cobsDecode(bad1, sizeof(bad1)), 0);
+}
+
+static void testCRC(void)
+{
+  const uint8_t check[] = "123456789";
+  uint8_t buf[MD_GamepadStream::FRAME_MAX];
+  MD_GamepadStream s;
+  MD_GamepadStream::frame_t f;
+
+  // the standard check value, and a block followed by its CRC has a CRC of 0
+  CHECK_EQ(MD_GamepadStream::crc8(check, 9), 0xf4);
+  memcpy(buf, check, 9);
+  buf[9] = 0xf4;
+  CHECK_EQ(MD_GamepadStream::crc8(buf, 10), 0);
+
+  // every single bit error in a frame is rejected
+  s.begin(0);
+  uint8_t n = s.encode(1000, 0x0123, -1234, 4321) - 1;
+
+  for (uint8_t i = 0; i < n; i++)
+    for (uint8_t b = 0; b < 8; b++)
+    {
+      memcpy(buf, s.data(), n);
+      buf[i] ^= 1 << b;
+      CHECK(!MD_GamepadStream::decode(buf, n, f));
+    }
+
+  // and so are frames with a byte missing or added
+  for (uint8_t i = 0; i < n; i++)
+  {
+    memcpy(buf, s.data(), i);
+    memcpy(&buf[i], s.data() + i + 1, n - i - 1);
+    CHECK(!MD_GamepadStream::decode(buf, n - 1, f));
+  }
+  memcpy(buf, s.data(), n);
+  buf[n] = 0x55;
+  CHECK(!MD_GamepadStream::decode(buf, n + 1, f));
+
+  // random errors in the decoded bytes are nearly always found
+  uint16_t missed = 0;
+
+  for (uint16_t k = 0; k < 2000; k++)
+  {
+    uint8_t raw[MD_GamepadStream::FRAME_RAW];
+
+    memcpy(buf, s.data(), n);
+    uint8_t m = MD_GamepadStream::cobsDecode(buf, n);
+
+    memcpy(raw, buf, m);
+    raw[rnd() % m] ^= 1 + rnd() % 255;
+    raw[rnd() % m] ^= 1 + rnd() % 255;
+    n = MD_GamepadStream::cobsEncode(raw, m, buf);
+    if (MD_GamepadStream::decode(buf, n, f))
+      missed++;
+    n = s.length() - 1;
+  }
+  CHECK(missed < 2000 / 64);
+}
+
+static void testDelta(void)
+{
+  MD_GamepadStream s;
+  MD_GamepadStream::frame_t f;
+  typedef MD_GamepadStream S;
+
+  s.begin(0);
+  memset(&f, 0, sizeof(f));
+
+  // the first frame is full
+  CHECK_EQ(send(s, f, 10, 0x0001, 100, -100), S::F_FULL | S::F_SW | S::F_X | S::F_Y);
+  CHECK_EQ(s.length(), S::FRAME_MAX);
+  CHECK_EQ(f.seq, 0);
+  CHECK_EQ(f.time, 10);
+  CHECK_EQ(f.sw, 0x0001);
+  CHECK_EQ(f.x, 100);
+  CHECK_EQ(f.y, -100);
+
+  // nothing is sent while nothing changes
+  for (uint32_t t = 11; t < 1000; t++)
+    CHECK_EQ(send(s, f, t, 0x0001, 100, -100), 0);
+
+  // then only the fields that changed, leaving the others as they were
+  CHECK_EQ(send(s, f, 1000, 0x0003, 100, -100), S::F_SW);
+  CHECK_EQ(f.seq, 1);
+  CHECK_EQ(f.time, 1000);
+  CHECK_EQ(f.sw, 0x0003);
+  CHECK_EQ(f.x, 100);
+  CHECK_EQ(f.y, -100);
+  CHECK_EQ(send(s, f, 1001, 0x0003, 0, -100), S::F_X);
+  CHECK_EQ(f.x, 0);
+  CHECK_EQ(send(s, f, 1002, 0x0003, 0, 0), S::F_Y);
+  CHECK_EQ(f.y, 0);
+  CHECK_EQ(send(s, f, 1003, 0x0000, INT16_MIN, INT16_MAX), S::F_SW | S::F_X | S::F_Y);
+  CHECK_EQ(f.seq, 4);
+  CHECK_EQ(f.sw, 0);
+  CHECK_EQ(f.x, INT16_MIN);
+  CHECK_EQ(f.y, INT16_MAX);
+
+  // a full frame can be forced
+  s.sendFull();
+  CHECK_EQ(send(s, f, 1004, 0x0000, INT16_MIN, INT16_MAX), S::F_FULL | S::F_SW | S::F_X | S::F_Y);
+  CHECK_EQ(send(s, f, 1005, 0x0000, INT16_MIN, INT16_MAX), 0);
+
+  // and the sequence number wraps
+  for (uint16_t i = 0; i < 300; i++)
+    send(s, f, 2000 + i, i, 0, 0);
+  CHECK_EQ(f.seq, (6 + 299) & 0xff);
+}
+
+static void testKeepalive(void)
+{
+  MD_GamepadStream s;
+  MD_GamepadStream::frame_t f;
+
+  // full frames are sent every keepalive period, whether or not the fields
+  // change, including across the wrap of the 16 bit time
+  for (uint8_t moving = 0; moving < 2; moving++)
+  {
+    uint32_t start = 65536UL - 1500;
+    uint32_t lastFull = start;
+    uint16_t fulls = 0, gapMax = 0;
+
+    s.begin(100);
+    for (uint32_t t = start; t < start + 3000; t++)
+    {
+      uint8_t flags = send(s, f, t, 0, moving ? (t & 0xff) : 0, moving ? -(int16_t)(t & 0x7f) : 0);
+
+      if (flags & MD_GamepadStream::F_FULL)
+      {
+        if (t - lastFull > gapMax) gapMax = t - lastFull;
+        lastFull = t;
+        fulls++;
+      }
+    }
+    CHECK_EQ(gapMax, 100);
+    CHECK_EQ(fulls, 30);
+  }
+
+  // with no keepalive only the first frame is full
+  uint16_t fulls = 0;
+
+  s.begin(0);
+  for (uint32_t t = 0; t < 3000; t++)
+    if (send(s, f, t, 0, t & 0xff, 0) & MD_GamepadStream::F_FULL)
+      fulls++;
+  CHECK_EQ(fulls, 1);
+}
+
+static void testStream(void)
+{
+  MD_GamepadStream s;
+  MD_GamepadStream::frame_t f = MD_GamepadStream::frame_t();
+  uint8_t buf[MD_GamepadStream::FRAME_MAX * 2];
+  uint8_t len = 0;
+  bool sync = false;
+  uint16_t frames = 0, sw = 0;
+  int16_t x = 0, y = 0;
+
+  // a receiver joining part way through a frame finds the next delimiter, and
+  // the latest value of every field is known after the next full frame
+  s.begin(50);
+  for (uint32_t t = 0; t < 2000; t++)
+  {
+    if ((rnd() & 7) == 0) sw ^= 1 << (rnd() & 0xf);
+    if ((rnd() & 3) == 0) x = rnd();
+    if ((rnd() & 3) == 0) y = rnd();
+
+    uint8_t n = s.encode(t, sw, x, y);
+
+    for (uint8_t i = (t == 0 ? 3 : 0); i < n; i++)
+    {
+      uint8_t c = s.data()[i];
+
+      if (c != 0)
+      {
+        if (len < sizeof(buf)) buf[len++] = c;
+        continue;
+      }
+      if (MD_GamepadStream::decode(buf, len, f))
+      {
+        sync |= (f.flags & MD_GamepadStream::F_FULL);
+        frames++;
+      }
+      len = 0;
+    }
+    if (sync && n != 0)
+      CHECK(f.sw == sw && f.x == x && f.y == y);
+  }
+  CHECK(sync);
+  CHECK(frames > 1000);
+}
+
+int main(void)
+{
+  RUN(testCOBS);
+  RUN(testCRC);
+  RUN(testDelta);
+  RUN(testKeepalive);
+  RUN(testStream);
+
+  return(testResult());
+}
@@ -17,11 +17,44 @@ The shield provides a additional groupings for _I2C_, _Nokia 5110_ display, _nRF
 and _Bluetooth_ modules which are not directly supported by this library, but could be 
 managed using other function specific libraries.
 
-All the hardware resources are declared at the top of the library file and can be modified 
-for alternative arrangements.
+When compiled outside the Arduino environment, the library includes MD_Gamepad_Host.h in place 
+of Arduino.h. This simulates the hardware used by the library (pins, ADC and clock) and counts 
+every hardware access, so the library can be built and exercised on a host computer. 
+The unit tests in extras/host/test use this, and are built and run with 
+`make -C extras/host check`.
+
+The hardware pin layout is defined at compile time by the MD_GamepadShield configuration 
+structure. Alternative arrangements are defined by a structure with the same members passed 
+as the template parameter to MD_GamepadT, without modifying the library files.
 
 Revision History 
 ----------------
+Oct 2026 - version 1.1.0
+- Digital switches read from port registers on ATmega328/168 (GAMEPAD_PORT_IO) for any switch pins on D0-D13 and A0-A5
+- Added getState(), getPressed(), getReleased() bitmap API
+- Digital switches and each analog axis have independent read delays
+- Added update() to sample the hardware once per loop; getters return the saved data
+- Joystick axes can be sampled in the background by the ADC interrupt (GAMEPAD_ADC_ISR)
+- Digital switches are debounced with vertical counters
+- Pin layout defined by a compile time configuration (MD_GamepadT<Config>), replacing the PIN_* defines
+- Library can be compiled on a host computer against a simulated hardware layer (MD_Gamepad_Host.h), with unit tests (extras/host/test)
+- Clock source is a template parameter (MD_GamepadClock) for simulation and replay
+- Added lock free input event queue, getEvent(), selected in the configuration
+- Switch edges can be captured with micros() timestamps by pin change interrupts (GAMEPAD_PCINT)
+- Added joystick oversampling and decimation, setOversample(), and setDeadband()
+- Added fixed point joystick axis filters (EMA, median of 3, One Euro) selected in the configuration
+- Added joystick calibration sweep and symmetrical normalized output, setOutputRange()
+- Added radial deadzone, anti-deadzone, outer saturation and circle to square mapping, setRadialDeadzone()
+- Added compile time response curve tables (expo, rate, S curve) selectable per axis, setCurve()
+- Added joystick magnitude, angle and 4/8/16 way direction with hysteresis, getJoystickSector()
+- Joystick axis directions use engage and release thresholds, setDirectionThresholds()
+- Added per input auto repeat with initial delay and acceleration, setRepeat(), selected in the configuration
+- Added chord and sequence detection with an input history, setCombos(), selected in the configuration
+- Added click, double click, long press and hold time events for the switches, setGestureTimes(), selected in the configuration
+- Added binary state stream format with COBS framing, CRC-8 and delta encoding (MD_Gamepad_Stream.h)
+- Added Linux host stream decoder, latency analyzer and stream simulator (extras/host)
+- Added nRF24L01 radio link layer with packed delta records, redundancy and configuration in ACK payloads (MD_Gamepad_Link.h)
+
 Jun 2018 - version 1.0.0
 - First release
 
@@ -46,7 +79,18 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
 
 #pragma once
 
+#ifdef ARDUINO
 #include <Arduino.h>
+#else
+#include "MD_Gamepad_Host.h"
+#endif
+#include "MD_Gamepad_Queue.h"
+#include "MD_Gamepad_Filter.h"
+#include "MD_Gamepad_Stick.h"
+#include "MD_Gamepad_Curve.h"
+#include "MD_Gamepad_Repeat.h"
+#include "MD_Gamepad_Combo.h"
+#include "MD_Gamepad_Gesture.h"
 
 /**
  * \file
@@ -57,24 +101,425 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
 #define ARRAY_SIZE(a) (sizeof(a)/sizeof(a[0]))    ///< Universal array size macro
 #define DEFAULT_DELAY 100   ///< Default delay between reads in milliseconds
 #define DEFAULT_DB    5     ///< Default deadband for ananlog zero conditioning
+#define DEFAULT_SCAN  5     ///< Default delay between debounce samples of the switches in milliseconds
+#define MAX_OVERSAMPLE 6    ///< Maximum oversampling, 4^6 samples for a 16 bit axis value
+#define DEFAULT_WAYS  8     ///< Default number of joystick directions for getJoystickSector()
+#define DEFAULT_HYST  5     ///< Default joystick direction hysteresis in degrees
+#define REPEAT_INPUTS 11    ///< Auto repeat inputs, the 7 switches and 4 joystick directions
+#define GESTURE_INPUTS 7    ///< Gesture inputs, the 7 switches
+
+#ifndef MAX_OVERSAMPLE_POLLED
+#define MAX_OVERSAMPLE_POLLED 3 ///< Maximum oversampling when update() makes the conversions, 4^3 take about 7ms per axis
+#endif
+
+#ifndef EVENT_QUEUE_SIZE
+#define EVENT_QUEUE_SIZE 16 ///< Number of slots in the input event queue, a power of 2 (holds one less event)
+#endif
 
-// Define pin numbers for the joystick shield 
-#define PIN_A 2   ///< A switch on the gamepad
-#define PIN_B 3   ///< B switch on the gamepad
-#define PIN_C 4   ///< C switch on the gamepad
-#define PIN_D 5   ///< D switch on the gamepad
-#define PIN_E 6   ///< E switch on the gamepad
-#define PIN_F 7   ///< F switch on the gamepad
-#define PIN_K 8   ///< K (joystick) switch on the gamepad
-#define PIN_X A0  ///< X axis analog pot
-#define PIN_Y A1  ///< Y axis analog pot
+#ifndef EDGE_QUEUE_SIZE
+#define EDGE_QUEUE_SIZE 16  ///< Number of slots in the pin change edge queue, a power of 2 (holds one less edge)
+#endif
 
 /**
- * Core object for the MD_Gamepad library
+ * Pin configuration for the joystick shield.
+ *
+ * This is the default configuration for MD_GamepadT. Alternative hardware 
+ * arrangements are defined by a structure with the same enumerated members 
+ * and passed as the template parameter to MD_GamepadT.
+ *
+ * The configuration also selects the filter applied to each joystick axis
+ * (see MD_Gamepad_Filter.h). A configuration derived from this one can 
+ * change just the filters:
+ * \code
+ * struct MyConfig : MD_GamepadShield
+ * {
+ *   typedef MD_GamepadFilterChain<MD_GamepadFilterMedian3, MD_GamepadFilterOneEuro<> > FilterX;
+ *   typedef MD_GamepadFilterChain<MD_GamepadFilterMedian3, MD_GamepadFilterOneEuro<> > FilterY;
+ * };
+ * MD_GamepadT<MyConfig> pad;
+ * \endcode
+ *
+ * In the same way, the configuration selects the optional input processing, 
+ * which uses no RAM unless it is selected:
+ * \code
+ * struct MyConfig : MD_GamepadShield
+ * {
+ *   typedef MD_GamepadRepeat<REPEAT_INPUTS> Repeat;   // auto repeat, setRepeat()
+ *   typedef MD_GamepadCombo Combo;                    // chords and sequences, setCombos()
+ *   typedef MD_GamepadQueue<MD_GamepadEvent, EVENT_QUEUE_SIZE> Events;  // input events, getEvent()
+ *   typedef MD_GamepadGesture<GESTURE_INPUTS> Gesture;  // switch gesture events, setGestureTimes()
+ * };
+ * \endcode
  */
-class MD_Gamepad
+struct MD_GamepadShield
+{
+  /**
+   * Pin numbers enumerated type.
+   */
+  enum
+  {
+    PIN_A = 2,   ///< A switch on the gamepad
+    PIN_B = 3,   ///< B switch on the gamepad
+    PIN_C = 4,   ///< C switch on the gamepad
+    PIN_D = 5,   ///< D switch on the gamepad
+    PIN_E = 6,   ///< E switch on the gamepad
+    PIN_F = 7,   ///< F switch on the gamepad
+    PIN_K = 8,   ///< K (joystick) switch on the gamepad
+    PIN_X = A0,  ///< X axis analog pot
+    PIN_Y = A1,  ///< Y axis analog pot
+  };
+
+  typedef MD_GamepadFilterNone FilterX;  ///< X axis filter
+  typedef MD_GamepadFilterNone FilterY;  ///< Y axis filter
+  typedef MD_GamepadRepeatNone Repeat;   ///< auto repeat engine
+  typedef MD_GamepadComboNone Combo;     ///< chord and sequence matcher
+  typedef MD_GamepadQueueNone Events;    ///< input event queue
+  typedef MD_GamepadGestureNone Gesture; ///< switch gesture classifier
+};
+
+/**
+ * \def GAMEPAD_PORT_IO
+ * Set to 1 to read the digital switches directly from the PIND/PINB/PINC port registers.
+ *
+ * When the switches are wired as on the shield (D2 to D8) on an ATmega328/168 based
+ * board, all the switches can be read with 2 register reads instead of up to 7 calls
+ * to digitalRead(). Configurations with the switches on other pins in D0-D13 and A0-A5
+ * read each port used once, with the port and bit of each switch worked out at compile 
+ * time (D0-D7 are PIND, D8-D13 PINB and A0-A5 PINC). A configuration with any switch on 
+ * another pin (eg, A6 or A7) uses digitalRead(). The default is automatically detected; 
+ * set to 0 to force the portable digitalRead() implementation.
+ */
+#ifndef GAMEPAD_PORT_IO
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega328__) || \
+    defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__)
+#define GAMEPAD_PORT_IO 1
+#else
+#define GAMEPAD_PORT_IO 0
+#endif
+#endif
+
+/**
+ * \def GAMEPAD_ADC_ISR
+ * Set to 1 to sample the joystick axes in the background using the ADC interrupt.
+ *
+ * In this mode the ADC continuously converts the X and Y pins, alternating between 
+ * them from the ADC conversion complete interrupt, and the latest conversion (or 
+ * oversampled conversions, see setOversample()) of each axis is saved. Reading an axis is then a copy of the saved value instead of 
+ * waiting around 110us for analogRead() to complete.
+ *
+ * The ADC is dedicated to the joystick in this mode, so analogRead() must not be used 
+ * by the application for other pins. Only supported on AVR processors. Default is 0.
+ */
+#ifndef GAMEPAD_ADC_ISR
+#define GAMEPAD_ADC_ISR 0
+#endif
+
+/**
+ * \def GAMEPAD_PCINT
+ * Set to 1 to capture the digital switch edges using pin change interrupts.
+ *
+ * In this mode every edge on the switches is recorded by the pin change interrupt, 
+ * with its Clock::micros() timestamp, in a queue read using getEdge(). The timestamps are
+ * exact to the interrupt latency and do not depend on how often update() is called.
+ * The switches are also only scanned by update() after an edge has been seen and 
+ * until the debounce has settled, so there is no polling while they are idle.
+ *
+ * Only supported for the shield pin layout (D2-D8) on ATmega328/168 processors, as 
+ * it uses the PCINT0 and PCINT2 interrupts. Default is 0.
+ */
+#ifndef GAMEPAD_PCINT
+#define GAMEPAD_PCINT 0
+#endif
+
+#if GAMEPAD_ADC_ISR
+/**
+ * Background ADC sampler for the joystick axes.
+ *
+ * Conversions are chained from the ADC interrupt, each one switching the 
+ * multiplexer to the other axis and starting the next conversion, so the 
+ * ADC runs continuously once started.
+ */
+struct MD_GamepadADC
+{
+  static volatile uint16_t value[2];  ///< latest conversion, [0] is the X axis and [1] the Y axis
+  static volatile uint8_t  axis;      ///< the axis being converted
+  static volatile uint8_t  shift;     ///< oversampling, 4^shift conversions per value
+  static uint32_t sum;                ///< sum of the conversions for the current value
+  static uint16_t samples;            ///< number of conversions in sum
+  static uint8_t mux[2];              ///< ADMUX register value for each axis
+
+  /**
+   * Start the background conversions.
+   *
+   * \param pinX the analog pin for the X axis.
+   * \param pinY the analog pin for the Y axis.
+   * \param x0 initial value for the X axis until the first conversion completes.
+   * \param y0 initial value for the Y axis until the first conversion completes.
+   * \param n  the oversampling, 4^n conversions per value.
+   */
+  static void begin(uint8_t pinX, uint8_t pinY, uint16_t x0, uint16_t y0, uint8_t n)
+  {
+    mux[0] = admux(pinX);
+    mux[1] = admux(pinY);
+    value[0] = x0;
+    value[1] = y0;
+    axis = 0;
+    shift = n;
+    sum = samples = 0;
+    ADMUX = mux[0];
+    ADCSRA = _BV(ADEN) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);  // 125kHz ADC clock at 16MHz
+    ADCSRA |= _BV(ADSC);
+  }
+
+  /**
+   * Read the latest conversion for an axis.
+   *
+   * The 16 bit value is read again until two consecutive reads match, so an 
+   * update by the interrupt between the two byte reads is never returned.
+   *
+   * \param i the axis to read, 0 for X and 1 for Y.
+   * \return the last conversion for the axis.
+   */
+  static uint16_t read(uint8_t i)
+  {
+    uint16_t v;
+
+    do { v = value[i]; } while (v != value[i]);
+
+    return(v);
+  }
+
+  /**
+   * Conversion complete interrupt handler.
+   *
+   * Add the conversion to the sum for the current axis. When 4^shift conversions 
+   * have been summed, save the decimated value for the axis and switch the 
+   * multiplexer to the other axis. Then start the next conversion.
+   */
+  static void isr(void)
+  {
+    sum += ADC;
+    if (++samples >= (1 << (2 * shift)))
+    {
+      value[axis] = sum >> shift;
+      sum = samples = 0;
+      axis ^= 1;
+      ADMUX = mux[axis];
+    }
+    ADCSRA |= _BV(ADSC);
+  }
+
+  /**
+   * ADMUX value (AVcc reference) for an analog pin.
+   *
+   * \param pin the analog pin.
+   * \return the ADMUX register value.
+   */
+  static inline uint8_t admux(uint8_t pin) 
+  { 
+    return(_BV(REFS0) | ((pin >= A0 ? pin - A0 : pin) & 0x07)); 
+  }
+};
+
+volatile uint16_t MD_GamepadADC::value[2];
+volatile uint8_t  MD_GamepadADC::axis;
+volatile uint8_t  MD_GamepadADC::shift;
+uint32_t MD_GamepadADC::sum;
+uint16_t MD_GamepadADC::samples;
+uint8_t MD_GamepadADC::mux[2];
+
+ISR(ADC_vect) { MD_GamepadADC::isr(); }
+#endif
+
+/**
+ * Input event.
+ *
+ * Events are queued for every change in the inputs so that the application 
+ * sees every transition, even those that start and end between two reads 
+ * by the application.
+ */
+struct MD_GamepadEvent
+{
+  /**
+   * Event type enumerated type.
+   */
+  enum type_t : uint8_t
+  {
+    EV_NONE,      ///< no event
+    EV_PRESS,     ///< switch pressed
+    EV_RELEASE,   ///< switch released
+    EV_AXIS,      ///< joystick axis changed direction, value is the new direction
+    EV_SYNC,      ///< events were lost when the queue was full, value is the number lost
+    EV_REPEAT,    ///< switch or joystick direction auto repeated, value is the direction for an axis
+    EV_COMBO,     ///< chord or sequence matched, id is the index in the combo table
+    EV_CLICK,         ///< switch clicked
+    EV_DOUBLE_CLICK,  ///< switch double clicked
+    EV_LONG_PRESS,    ///< switch held for the long press time
+    EV_HOLD_RELEASE,  ///< switch released after a long press, value is the hold time in milliseconds
+  };
+
+  uint32_t time;  ///< time of the event in milliseconds
+  type_t  type;   ///< the type of event
+  uint8_t id;     ///< the switch_t value of the input
+  int16_t value;  ///< value for the event type
+
+  /**
+   * Merge an event that did not fit in the queue into this one.
+   *
+   * All the events merged are replaced by a single EV_SYNC event. The 
+   * application should then read the current state of the inputs instead
+   * of relying on the events.
+   *
+   * \param e the event to merge.
+   */
+  void coalesce(const MD_GamepadEvent &e)
+  {
+    time = e.time;
+    type = EV_SYNC;
+    id = 0;
+    value++;
+  }
+};
+
+#if GAMEPAD_PCINT
+/**
+ * Pin change interrupt capture of the switch edges.
+ *
+ * The switches A-F (D2-D7) are on PCINT2 and switch K (D8) is on PCINT0. 
+ * Each interrupt compares the port with its last value and queues an event 
+ * for each switch that changed.
+ */
+struct MD_GamepadPCINT
+{
+  static MD_GamepadQueue<MD_GamepadEvent, EDGE_QUEUE_SIZE> edges;  ///< queue of captured edges
+  static volatile uint8_t lastD;     ///< last value read from port D
+  static volatile uint8_t lastB;     ///< last value read from port B
+  static volatile bool changed;      ///< set by an edge, cleared by the application
+  static uint32_t (*micros)(void);   ///< the clock for the edge timestamps
+
+  /**
+   * Start capturing the switch edges.
+   *
+   * \param clock the function returning the time in microseconds for the edge timestamps.
+   */
+  static void begin(uint32_t (*clock)(void))
+  {
+    micros = clock;
+    edges.clear();
+    lastD = PIND;
+    lastB = PINB;
+    changed = true;
+    PCMSK2 |= 0xfc;   // PCINT18-23 on D2-D7
+    PCMSK0 |= 0x01;   // PCINT0 on D8
+    PCICR |= _BV(PCIE2) | _BV(PCIE0);
+  }
+
+  /**
+   * Pin change interrupt handler for port D (switches A-F).
+   */
+  static void isrD(void)
+  {
+    uint32_t t = micros();
+    uint8_t v = PIND;
+    uint8_t diff = (v ^ lastD) & 0xfc;
+
+    lastD = v;
+    // D2-D7 are switches SW_A-SW_F (1-6)
+    for (uint8_t bit = 2; bit < 8; bit++)
+      if (diff & _BV(bit))
+        queue(t, bit - 1, !(v & _BV(bit)));
+  }
+
+  /**
+   * Pin change interrupt handler for port B (switch K).
+   */
+  static void isrB(void)
+  {
+    uint32_t t = micros();
+    uint8_t v = PINB;
+
+    if ((v ^ lastB) & 0x01)
+      queue(t, 7, !(v & 0x01));   // D8 is switch SW_K (7)
+    lastB = v;
+  }
+
+  /**
+   * Queue an edge event.
+   *
+   * \param t       the time of the edge in microseconds.
+   * \param sw      the switch_t value for the switch.
+   * \param pressed true if the switch is now pressed.
+   */
+  static void queue(uint32_t t, uint8_t sw, bool pressed)
+  {
+    MD_GamepadEvent e;
+
+    e.time = t;
+    e.type = pressed ? MD_GamepadEvent::EV_PRESS : MD_GamepadEvent::EV_RELEASE;
+    e.id = sw;
+    e.value = 0;
+    edges.push(e);
+    changed = true;
+  }
+};
+
+MD_GamepadQueue<MD_GamepadEvent, EDGE_QUEUE_SIZE> MD_GamepadPCINT::edges;
+volatile uint8_t MD_GamepadPCINT::lastD;
+volatile uint8_t MD_GamepadPCINT::lastB;
+volatile bool MD_GamepadPCINT::changed;
+uint32_t (*MD_GamepadPCINT::micros)(void);
+
+ISR(PCINT2_vect) { MD_GamepadPCINT::isrD(); }
+ISR(PCINT0_vect) { MD_GamepadPCINT::isrB(); }
+#endif
+
+/**
+ * Default clock source for MD_GamepadT.
+ *
+ * All the timing in the library is taken from the Clock template parameter 
+ * of MD_GamepadT, including the pin change edge timestamps (GAMEPAD_PCINT), 
+ * which the interrupt handlers take through a pointer to Clock::micros() set 
+ * by begin(). This default uses the Arduino millis() and micros(), and 
+ * compiles down to the same calls.
+ *
+ * An alternative clock source is a structure with the same static methods. 
+ * For example, a simulation can step a virtual time in exact increments and 
+ * run faster than real time, or replay a recorded session deterministically:
+ * \code
+ * struct SimClock
+ * {
+ *   static uint32_t now;  // in microseconds, set by the simulation
+ *   static inline uint32_t millis(void) { return(now / 1000); }
+ *   static inline uint32_t micros(void) { return(now); }
+ * };
+ * MD_GamepadT<MD_GamepadShield, SimClock> pad;
+ * \endcode
+ */
+struct MD_GamepadClock
+{
+  /**
+   * Get the time in milliseconds.
+   *
+   * \return the time in milliseconds.
+   */
+  static inline uint32_t millis(void) { return(::millis()); }
+
+  /**
+   * Get the time in microseconds.
+   *
+   * \return the time in microseconds.
+   */
+  static inline uint32_t micros(void) { return(::micros()); }
+};
+
+/**
+ * Definitions common to all MD_GamepadT configurations.
+ *
+ * The switch names are declared here so that they are the same type for every 
+ * configuration, and can be written as MD_Gamepad::SW_A for any of them.
+ */
+struct MD_GamepadBase
 {
-  public:
   /**
   * Switch name enumerated type.
   *
@@ -82,6 +527,27 @@ class MD_Gamepad
   * SW_NONE is used if no switch is named.
   */
   enum switch_t { SW_NONE, SW_A, SW_B, SW_C, SW_D, SW_E, SW_F, SW_K, SW_X, SW_Y };
+};
+
+/**
+ * Core object for the MD_Gamepad library
+ *
+ * The hardware pin layout is fixed at compile time by the Config template 
+ * parameter, so the pins cost no RAM and the switch scan is unrolled into 
+ * direct reads of each pin. MD_Gamepad is this class with the default 
+ * shield configuration.
+ *
+ * \tparam Config structure defining the hardware pins (see MD_GamepadShield).
+ * \tparam Clock  structure providing the time (see MD_GamepadClock).
+ */
+template <class Config = MD_GamepadShield, class Clock = MD_GamepadClock>
+class MD_GamepadT : public MD_GamepadBase
+{
+  public:
+  /**
+   * Input event queue type.
+   */
+  typedef typename Config::Events eventQueue_t;
 
  /** 
    * Initialize the object.
@@ -92,17 +558,55 @@ class MD_Gamepad
   void begin(void)
   {
     // initialize the hardware
-    for (uint8_t i=0; i<ARRAY_SIZE(_pinDigital); i++)
-      pinMode(_pinDigital[i].pin, INPUT_PULLUP);
-    pinMode(PIN_X, INPUT);
-    pinMode(PIN_Y, INPUT);
+    for (uint8_t sw = SW_A; sw <= SW_K; sw++)
+      pinMode(swPin((switch_t)sw), INPUT_PULLUP);
+    pinMode(Config::PIN_X, INPUT);
+    pinMode(Config::PIN_Y, INPUT);
 
     // other variables
-    _timeBetweenReads = DEFAULT_DELAY;
+    setReadDelay(DEFAULT_DELAY);
+    setDebounceDelay(DEFAULT_SCAN);
+    _ct0 = _ct1 = 0xff;
+    _events.clear();
+    _repeat.begin();
+    _combo.begin();
+    _gesture.begin();
     _deadband = DEFAULT_DB;
+    _oversample = 0;
+    _dir[0] = _dir[1] = 0;
+    for (uint8_t i = 0; i < 2; i++)
+      for (uint8_t d = 0; d < 2; d++)
+      {
+        _engage[i][d] = 1;
+        _release[i][d] = 0;
+      }
+    _axis[0] = _axis[1] = 0;
+    _filterX.reset(0);
+    _filterY.reset(0);
 
-    _offsetX = analogRead(PIN_X);
-    _offsetY = analogRead(PIN_Y);
+    _outRange = 0;
+    _calibrating = false;
+    for (uint8_t i = 0; i < 2; i++)
+    {
+      _cal[i].min = 0;
+      _cal[i].center = readCenter(i == 0 ? Config::PIN_X : Config::PIN_Y);
+      _cal[i].max = 1023U << MAX_OVERSAMPLE;
+      setScale(i);
+    }
+    _stick.begin(fullRange());
+    _curve[0].begin(fullRange());
+    _curve[1].begin(fullRange());
+    _sector.begin(DEFAULT_WAYS, DEFAULT_HYST);
+    _magnitude = _angle = 0;
+
+#if GAMEPAD_ADC_ISR
+    MD_GamepadADC::begin(Config::PIN_X, Config::PIN_Y, _cal[0].center >> (MAX_OVERSAMPLE - _oversample), 
+      _cal[1].center >> (MAX_OVERSAMPLE - _oversample), _oversample);
+#endif
+#if GAMEPAD_PCINT
+    static_assert(isShieldLayout(), "GAMEPAD_PCINT needs the switches on D2-D8");
+    MD_GamepadPCINT::begin(Clock::micros);
+#endif
   }
 
  /** 
@@ -113,39 +617,574 @@ class MD_Gamepad
    * This can be used by the application to throttle the speed of repeat keypress detection
    * when a switch is kept active by a user. The value is initialized to DEFAULT_DELAY.
    *
+   * The same delay is set for the digital switches and both analog axes. Each of these
+   * channels is timed independently.
+   *
+   * \param d  the new delay value.
+   * \return No return value.
+   */
+  inline void setReadDelay(uint16_t d) { for (uint8_t i = CH_DIGITAL; i <= CH_Y; i++) _timeBetweenReads[i] = d; }
+
+ /** 
+   * Set the minimum time between reads for one channel.
+   * 
+   * Set the minimum time in milliseconds between reads of the analog axis specified 
+   * (SW_X or SW_Y) or, for any other switch_t value, of the digital switches.
+   *
+   * Each channel keeps its own read timer, so every axis is sampled at its configured 
+   * rate irrespective of the order in which the application queries them.
+   *
+   * \param sw the switch_t value for the channel to set.
    * \param d  the new delay value.
    * \return No return value.
    */
-  inline void setReadDelay(uint16_t d) { _timeBetweenReads = d; }
+  inline void setReadDelay(switch_t sw, uint16_t d) { _timeBetweenReads[swChannel(sw)] = d; }
+
+ /** 
+   * Set the time between debounce samples.
+   * 
+   * The digital switches are sampled with this delay in milliseconds and a switch must 
+   * read the same for 4 consecutive samples before its debounced state changes. The 
+   * value is initialized to DEFAULT_SCAN.
+   *
+   * \param d  the new delay value.
+   * \return No return value.
+   */
+  inline void setDebounceDelay(uint16_t d) { _timeBetweenReads[CH_SCAN] = d; }
+
+ /**
+   * Set the joystick deadband.
+   *
+   * Joystick values within +/- the deadband of the center are reported as 0. The 
+   * deadband is in the same units as getJoystickValue(), so it scales with the 
+   * oversampling. The value is initialized to DEFAULT_DB.
+   *
+   * The deadband is applied to each axis separately, which makes a square deadzone. 
+   * Setting the deadband disables the radial deadzone.
+   *
+   * \sa setRadialDeadzone()
+   *
+   * \param db the new deadband value.
+   * \return No return value.
+   */
+  inline void setDeadband(uint16_t db) { _deadband = db; _stick.enable(false); }
+
+ /**
+   * Set the joystick radial deadzone.
+   *
+   * The X and Y values are conditioned together as a vector, so the direction of the 
+   * joystick is preserved and small diagonal movements do not snap to an axis (see 
+   * MD_GamepadStick). The per axis deadband is not used while the radial deadzone 
+   * is enabled.
+   * 
+   * All the radii are in percent of full deflection, which is the output range if 
+   * set, otherwise 512 << the oversampling.
+   *
+   * \sa setDeadband(), setCircleToSquare(), setOutputRange()
+   *
+   * \param inner the deadzone radius, values closer to the center are reported as 0.
+   * \param outer the saturation radius, values further out are reported as full deflection.
+   * \param anti  the anti-deadzone, the smallest radius reported outside the deadzone.
+   * \return No return value.
+   */
+  inline void setRadialDeadzone(uint8_t inner, uint8_t outer = 100, uint8_t anti = 0) { _stick.set(inner, outer, anti); }
+
+ /**
+   * Set the joystick circle to square mapping.
+   *
+   * Most joysticks move inside a circular gate, so X and Y cannot both reach full 
+   * deflection together. When enabled the circular travel is stretched onto a 
+   * square so the corners can be reached. Only used with the radial deadzone.
+   *
+   * \param b true to enable the mapping, false to disable it.
+   * \return No return value.
+   */
+  inline void setCircleToSquare(bool b) { _stick.setSquare(b); }
+
+ /**
+   * Set the joystick response curve for an axis.
+   *
+   * The curve is applied to the axis value after the deadzone. Curve tables are 
+   * built at compile time in program memory with the GAMEPAD_CURVE macro (see 
+   * MD_Gamepad_Curve.h) and the table in use can be changed at any time, for 
+   * example to switch between normal and low rates. The default is no curve.
+   *
+   * \param sw    the switch_t value for the analog axis (SW_X or SW_Y).
+   * \param table the curve table, nullptr for a linear response.
+   * \return No return value.
+   */
+  inline void setCurve(switch_t sw, const uint16_t *table) { _curve[sw == SW_Y ? 1 : 0].setTable(table); }
+
+ /**
+   * Set the joystick axis oversampling.
+   *
+   * Each joystick value is the sum of 4^n analog conversions decimated by 2^n, 
+   * giving n more bits of resolution and less noise than a single conversion. The 
+   * joystick values returned are then in the range +/-(512 << n). 
+   * 
+   * Oversampling n=0 (the default) is a single conversion. With GAMEPAD_ADC_ISR the
+   * conversions are made in the background, up to MAX_OVERSAMPLE. Otherwise all the 
+   * conversions for an axis are made by update() and take about 110us each, so the 
+   * oversampling is limited to MAX_OVERSAMPLE_POLLED to keep update() from blocking 
+   * the application (4^6 conversions for both axes would take about 0.9s).
+   *
+   * \param n the oversampling, 0 to MAX_OVERSAMPLE (GAMEPAD_ADC_ISR) or MAX_OVERSAMPLE_POLLED.
+   * \return No return value.
+   */
+  void setOversample(uint8_t n)
+  {
+#if GAMEPAD_ADC_ISR
+    _oversample = (n > MAX_OVERSAMPLE ? MAX_OVERSAMPLE : n);
+    MD_GamepadADC::shift = _oversample;
+#else
+    _oversample = (n > MAX_OVERSAMPLE_POLLED ? MAX_OVERSAMPLE_POLLED : n);
+#endif
+    setFullRange();
+  }
+
+  /**
+   * Joystick axis calibration data.
+   *
+   * All the values are analog readings left justified in 16 bits (the 
+   * 10 bit reading multiplied by 1 << MAX_OVERSAMPLE).
+   */
+  struct calib_t
+  {
+    uint16_t min;     ///< reading at the negative end of the axis travel
+    uint16_t center;  ///< reading with the joystick centered
+    uint16_t max;     ///< reading at the positive end of the axis travel
+  };
+
+ /**
+   * Set the normalized joystick output range.
+   *
+   * When the range is 0 (the default) the joystick values are the analog reading 
+   * minus the center reading, so the negative and positive deflections have 
+   * different maximum values.
+   *
+   * Otherwise each half of the axis travel, from the calibrated center to the 
+   * calibrated min or max, is scaled separately to 0..range, so the joystick values 
+   * are symmetrical in the range +/-range (for example +/-127 or +/-32767). The 
+   * scaling uses precomputed fixed point reciprocals, so it costs one multiply 
+   * and shift for each value. The deadband is applied to the normalized value.
+   *
+   * \sa calibrateStart(), setCalibration()
+   *
+   * \param range the output range, 0 to 32767.
+   * \return No return value.
+   */
+  void setOutputRange(uint16_t range)
+  {
+    _outRange = (range > INT16_MAX ? INT16_MAX : range);
+    setScale(0);
+    setScale(1);
+    setFullRange();
+  }
+
+ /**
+   * Start a joystick calibration sweep.
+   *
+   * The joystick must be centered when this method is called, and the center 
+   * reading for each axis is taken. The application should then ask the user to 
+   * move the joystick around its full travel a few times, calling update() as 
+   * usual, while the minimum and maximum readings on each axis are recorded. The 
+   * sweep is ended by calling calibrateEnd().
+   *
+   * \return No return value.
+   */
+  void calibrateStart(void)
+  {
+    for (uint8_t i = 0; i < 2; i++)
+    {
+#if GAMEPAD_ADC_ISR
+      _cal[i].center = readRaw(i) << (MAX_OVERSAMPLE - _oversample);
+#else
+      _cal[i].center = readCenter(i == 0 ? Config::PIN_X : Config::PIN_Y);
+#endif
+      _cal[i].min = _cal[i].max = _cal[i].center;
+    }
+    _calibrating = true;
+  }
+
+ /**
+   * End a joystick calibration sweep.
+   *
+   * The calibration recorded since calibrateStart() is checked and, if the joystick 
+   * was moved at least a quarter of the analog range on each side of the center on 
+   * both axes, it is used for normalization. Otherwise the previous calibration is 
+   * restored.
+   *
+   * \return true if the new calibration is used, false if it was rejected.
+   */
+  bool calibrateEnd(void)
+  {
+    const uint16_t minSpan = (1024 / 4) << MAX_OVERSAMPLE;
+    bool ok = true;
+
+    _calibrating = false;
+    for (uint8_t i = 0; i < 2; i++)
+      ok = ok && (_cal[i].center - _cal[i].min >= minSpan) && (_cal[i].max - _cal[i].center >= minSpan);
+
+    for (uint8_t i = 0; i < 2; i++)
+    {
+      if (ok)
+        _calPrev[i] = _cal[i];
+      else
+        _cal[i] = _calPrev[i];
+      setScale(i);
+    }
+
+    return(ok);
+  }
+
+ /**
+   * Set the joystick calibration for an axis.
+   *
+   * Used to restore a calibration saved by the application, for example in EEPROM.
+   *
+   * \param sw  the switch_t value for the analog axis (SW_X or SW_Y).
+   * \param cal the calibration data for the axis.
+   * \return No return value.
+   */
+  void setCalibration(switch_t sw, const calib_t &cal)
+  {
+    uint8_t i = (sw == SW_Y ? 1 : 0);
+
+    _cal[i] = _calPrev[i] = cal;
+    setScale(i);
+  }
+
+ /**
+   * Get the joystick calibration for an axis.
+   *
+   * \param sw  the switch_t value for the analog axis (SW_X or SW_Y).
+   * \return the calibration data for the axis.
+   */
+  inline calib_t getCalibration(switch_t sw) { return(_cal[sw == SW_Y ? 1 : 0]); }
+
+ /**
+   * Update the gamepad inputs.
+   *
+   * This method must be called once every time through the application loop(). It reads 
+   * the time once and samples each digital or analog channel whose read delay has expired, 
+   * saving the results as a coherent frame of input data.
+   *
+   * All the other methods that return switch or joystick information are reads of the 
+   * data saved by the last call to update() and do not access the hardware.
+   *
+   * \return true if any channel was sampled during this update.
+   */
+  bool update(void)
+  {
+    uint32_t now = Clock::millis();
+
+    _frameRead = 0;
+    _statePrev = _stateCurr;
+
+    if (isReadDue(CH_SCAN, now) && isScanNeeded())
+    {
+      _stateCurr = debounce(readSwitches());
+      queueSwitchEvents(now);
+    }
+
+    if (isReadDue(CH_DIGITAL, now))
+      _frameRead |= (1 << CH_DIGITAL);
+
+    for (uint8_t ch = CH_X; ch <= CH_Y; ch++)
+    {
+      uint16_t dt = now - _timeLastRead[ch];
+
+      if (isReadDue((channel_t)ch, now))
+      {
+        readAxis((channel_t)ch, dt);
+        _frameRead |= (1 << ch);
+      }
+    }
+
+    if (_frameRead & ((1 << CH_X) | (1 << CH_Y)))
+    {
+      conditionAxes();
+      queueAxisEvent(CH_X, now);
+      queueAxisEvent(CH_Y, now);
+    }
+    updateRepeat(now);
+    updateCombo(now);
+    updateGesture(now);
+    _events.flush();
+
+    return(_frameRead != 0);
+  }
+
+ /**
+   * Get the next input event.
+   *
+   * Every switch press and release and every change in joystick axis direction 
+   * detected by update() is queued as an event. The application can remove the 
+   * events one at a time, so no transition is lost even if the application loop 
+   * is occasionally slow.
+   *
+   * Events are only available if the configuration selects MD_GamepadQueue as the 
+   * Events type (see MD_GamepadShield). Otherwise no events are queued and this 
+   * always returns false. The repeat, combo and gesture events are also only 
+   * delivered through the queue.
+   *
+   * \sa setEventOverflow()
+   *
+   * \param e the event structure to receive the event.
+   * \return true if an event was returned, false if the queue is empty.
+   */
+  inline bool getEvent(MD_GamepadEvent &e) { return(_events.pop(e)); }
+
+ /**
+   * Set the event queue overflow behavior.
+   *
+   * Set what happens to new events when the event queue is full (see MD_GamepadQueue).
+   * The default is to drop the newest events.
+   *
+   * \param o the new overflow behavior.
+   * \return No return value.
+   */
+  inline void setEventOverflow(typename eventQueue_t::overflow_t o) { _events.setOverflow(o); }
+
+ /**
+   * Get the number of events lost.
+   *
+   * \return the number of events lost because the event queue was full, including
+   * the events merged into an EV_SYNC event.
+   */
+  inline uint16_t getEventsDropped(void) { return(_events.dropped()); }
+
+#if GAMEPAD_PCINT
+ /**
+   * Get the next captured switch edge.
+   *
+   * Only available when GAMEPAD_PCINT is set to 1. Each edge on a switch pin is 
+   * captured by the pin change interrupt as an EV_PRESS or EV_RELEASE event with 
+   * the time field set to the Clock::micros() time of the edge. Edges are not debounced, 
+   * so a bouncing contact produces several edges; the first press edge gives the 
+   * precise time the switch was pressed.
+   *
+   * \param e the event structure to receive the edge.
+   * \return true if an edge was returned, false if the queue is empty.
+   */
+  inline bool getEdge(MD_GamepadEvent &e) { return(MD_GamepadPCINT::edges.pop(e)); }
+#endif
 
  /** 
    * Test for any digital switch pressed.
    * 
-   * The method returns true if any of the digital keys are pressed.
+   * The method returns true if any of the digital keys are pressed in the 
+   * last debounced snapshot taken by update().
    *
    * \return true if any digital key has been pressed.
    */
-  inline bool anyKey(void) { return(getSwitch() != SW_NONE); }
+  inline bool anyKey(void) { return(_stateCurr != 0); }
+
+ /**
+   * Get the bitmap of all the digital switches.
+   *
+   * Return the last debounced snapshot of all the digital switches taken by update() as a bitmap.
+   * Each switch_t value is one bit in the bitmap (see swBit()) and the bit is set 
+   * if the switch is pressed. Any number of switches can then be tested from the 
+   * one snapshot.
+   *
+   * The snapshot from the previous update() is retained so that the switches that 
+   * changed state in this update can be retrieved using getPressed() and getReleased().
+   *
+   * \sa getPressed(), getReleased()
+   *
+   * \return The bitmap of the switches currently pressed.
+   */
+  inline uint16_t getState(void) { return(_stateCurr); }
+
+ /**
+   * Get the switches pressed since the last snapshot.
+   *
+   * Returns the bitmap of the switches that were not pressed in the previous 
+   * snapshot and are pressed in the current snapshot taken by update().
+   *
+   * \return The bitmap of the newly pressed switches.
+   */
+  inline uint16_t getPressed(void) { return((_stateCurr ^ _statePrev) & _stateCurr); }
+
+ /**
+   * Get the switches released since the last snapshot.
+   *
+   * Returns the bitmap of the switches that were pressed in the previous 
+   * snapshot and are not pressed in the current snapshot taken by update().
+   *
+   * \return The bitmap of the newly released switches.
+   */
+  inline uint16_t getReleased(void) { return((_stateCurr ^ _statePrev) & _statePrev); }
+
+ /**
+   * Set the auto repeat for an input.
+   *
+   * A switch or joystick direction fires once when it is pressed, again after the 
+   * delay and then every interval for as long as it is held (typematic repeat). The 
+   * interval can be made shorter at each repeat by the acceleration, down to the 
+   * minimum interval, so holding an input longer repeats it faster.
+   * 
+   * Each switch and each side of each joystick axis has its own settings. Repeat is 
+   * initially disabled for all inputs, so they only fire when pressed.
+   *
+   * Auto repeat is only available if the configuration selects MD_GamepadRepeat as 
+   * the Repeat type (see MD_GamepadShield). Otherwise the settings are ignored.
+   *
+   * \sa getRepeat(), getJoystickRepeat()
+   *
+   * \param sw          the switch_t value for the switch, or the axis (SW_X or SW_Y) for both its directions.
+   * \param delay       the time from the press to the first repeat in milliseconds.
+   * \param interval    the time between repeats in milliseconds, 0 for no repeat.
+   * \param minInterval the shortest time between repeats with acceleration, 0 for no acceleration.
+   * \param accel       the interval reduction at each repeat, in 1/256 of the interval.
+   * \return No return value.
+   */
+  void setRepeat(switch_t sw, uint16_t delay, uint16_t interval, uint16_t minInterval = 0, uint8_t accel = 0)
+  {
+    if (sw == SW_X || sw == SW_Y)
+    {
+      uint8_t i = RPT_AXIS + 2 * (sw - SW_X);
+
+      _repeat.set(i, delay, interval, minInterval, accel);
+      _repeat.set(i + 1, delay, interval, minInterval, accel);
+    }
+    else if (sw != SW_NONE)
+      _repeat.set(sw - SW_A, delay, interval, minInterval, accel);
+  }
+
+ /**
+   * Set the auto repeat for all the inputs.
+   *
+   * \sa setRepeat(switch_t, uint16_t, uint16_t, uint16_t, uint8_t)
+   *
+   * \param delay       the time from the press to the first repeat in milliseconds.
+   * \param interval    the time between repeats in milliseconds, 0 for no repeat.
+   * \param minInterval the shortest time between repeats with acceleration, 0 for no acceleration.
+   * \param accel       the interval reduction at each repeat, in 1/256 of the interval.
+   * \return No return value.
+   */
+  void setRepeat(uint16_t delay, uint16_t interval, uint16_t minInterval = 0, uint8_t accel = 0)
+  {
+    for (uint8_t i = 0; i < RPT_COUNT; i++)
+      _repeat.set(i, delay, interval, minInterval, accel);
+  }
+
+ /**
+   * Get the switches that fired in this update.
+   *
+   * Returns the bitmap of the switches that were pressed or auto repeated in 
+   * this update (see setRepeat()). Repeats are also queued as EV_REPEAT events.
+   *
+   * \return The bitmap of the switches that fired.
+   */
+  inline uint16_t getRepeat(void) { return((_repeat.fired() & RPT_SWITCHES) << SW_A); }
+
+ /**
+   * Get the joystick direction that fired in this update.
+   *
+   * Returns the direction of the axis if it was engaged or auto repeated in 
+   * this update (see setRepeat()), so a held joystick can step through a menu.
+   *
+   * \param sw the switch_t value for the analog axis (SW_X or SW_Y).
+   * \return 0 if not fired, 1 for positive or -1 for negative direction.
+   */
+  int8_t getJoystickRepeat(switch_t sw)
+  {
+    uint8_t i = RPT_AXIS + 2 * (sw == SW_Y ? 1 : 0);
+    uint16_t f = _repeat.fired();
+
+    return((f & (1 << i)) ? 1 : ((f & (1 << (i + 1))) ? -1 : 0));
+  }
+
+ /**
+   * Set the combo table.
+   *
+   * The chords and sequences in the table are detected by update() from the switch 
+   * and joystick direction snapshots (see MD_Gamepad_Combo.h). Each match is 
+   * queued as an EV_COMBO event with the index of the combo in the table. The table 
+   * is not copied and must remain valid while it is in use.
+   *
+   * Combos are only available if the configuration selects MD_GamepadCombo as 
+   * the Combo type (see MD_GamepadShield). Otherwise the table is ignored.
+   *
+   * \sa getCombo()
+   *
+   * \param def   the combo table.
+   * \param count the number of combos in the table, up to COMBO_MAX.
+   * \return No return value.
+   */
+  inline void setCombos(const MD_GamepadComboDef *def, uint8_t count) { _combo.set(def, count); }
+
+ /**
+   * Set the switch gesture times.
+   *
+   * When enabled, every switch press is classified from the debounced snapshots 
+   * and queued as an EV_CLICK, EV_DOUBLE_CLICK, EV_LONG_PRESS or EV_HOLD_RELEASE 
+   * event (see MD_GamepadGesture). A click is only reported once the double click 
+   * time has passed without another press. Gestures are initially disabled.
+   *
+   * Gestures are only available if the configuration selects MD_GamepadGesture as 
+   * the Gesture type (see MD_GamepadShield). Otherwise the times are ignored. As 
+   * gestures are only reported as events, they also need the configuration to 
+   * select the event queue (see getEvent()).
+   *
+   * \param doubleClick the time allowed between a release and the next press for a double click.
+   * \param longPress   the time a switch must be held for a long press, 0 to disable gestures.
+   * \return No return value.
+   */
+  inline void setGestureTimes(uint16_t doubleClick, uint16_t longPress) { _gesture.setTimes(doubleClick, longPress); }
+
+ /**
+   * Get the combos matched in this update.
+   *
+   * \return The bitmap of the combos matched, bit n for combo n in the table.
+   */
+  inline uint16_t getCombo(void) { return(_combo.matched()); }
+
+ /**
+   * Get an input history entry.
+   *
+   * The history holds the last HISTORY_SIZE updates in which a switch or joystick 
+   * direction was newly pressed, with the time of the update. The input bitmap 
+   * uses the same bits as the combo definitions. The history is always empty 
+   * unless the configuration selects MD_GamepadCombo.
+   *
+   * \param n the entry, 0 for the most recent.
+   * \param e the variable to receive the entry.
+   * \return true if the entry exists.
+   */
+  inline bool getHistory(uint8_t n, MD_GamepadHistory::entry_t &e) { return(_combo.history().get(n, e)); }
+
+ /**
+   * Get the bitmap mask for a switch.
+   *
+   * Convert a switch_t value into the mask for its bit in the bitmaps
+   * returned by getState(), getPressed() and getReleased().
+   *
+   * \param sw the switch_t value to convert.
+   * \return The bitmap mask for the switch.
+   */
+  static constexpr uint16_t swBit(switch_t sw) { return(1 << sw); }
 
   /**
   * Get the value of the currently pressed switch.
   *
   * Returns the switch_t value of the first digital switch that is detected active.
-  * If no key is found, return SW_NONE.
+  * If no key is found, or the switches were not read in the last update(), return SW_NONE.
   *
   * \return The switch_t value corresponding to the switch pressed, SW_NONE if no key.
   */
   switch_t getSwitch(void)
   {
-    // check if it is time to read something
-    if (millis() - _timeLastDigital < _timeBetweenReads)
+    // check if something was read in this frame
+    if (!(_frameRead & (1 << CH_DIGITAL)))
       return(SW_NONE);
-    _timeLastDigital = millis();
 
-    // now read and return the first pin found
-    for (uint8_t i = 0; i < ARRAY_SIZE(_pinDigital); i++)
-      if (digitalRead(_pinDigital[i].pin) == LOW)
-        return(_pinDigital[i].sw);
+    // return the first switch found in the snapshot
+    for (uint8_t sw = SW_A; sw <= SW_K; sw++)
+      if (_stateCurr & swBit((switch_t)sw))
+        return((switch_t)sw);
 
     return(SW_NONE);
   }
@@ -157,8 +1196,10 @@ class MD_Gamepad
   * This method will tell the application whether a joystick is pushed into the positive or 
   * negative range of the analog axis. 
   * 
-  * A small deadband is applied around the zero value to avoid jittery feedback when the joystick 
-  * is centered. If the time delay between reads has not expired, 0 is returned.
+  * The direction has separate engage and release thresholds (see setDirectionThresholds()), 
+  * so it does not chatter when the joystick is held near a threshold. Every change of 
+  * direction is also queued as an EV_AXIS event. If the axis was not read in the last 
+  * update(), 0 is returned.
   *
   * \see getJoystickValue() for the joystick position value.
   *
@@ -167,13 +1208,12 @@ class MD_Gamepad
   */
   int8_t getJoystickDirection(switch_t sw)
   {
-    int16_t v;
+    channel_t ch = swChannel(sw);
 
-    if (millis() - _timeLastAnalog < _timeBetweenReads)
+    if (ch == CH_DIGITAL || !(_frameRead & (1 << ch)))
       return(0);
-    v = getJoystickValue(sw);
     
-    return(v == 0 ? 0 : (v<0 ? -1 : 1));
+    return(_dir[ch - CH_X]);
   }
 
   /**
@@ -185,7 +1225,7 @@ class MD_Gamepad
   * analog reading to created +/- range of values centred around 0.
   * 
   * A small deadband is applied around the zero value to avoid jittery feedback when the joystick 
-  * is centered. If the time delay between reads has not expired, the last value read is returned.
+  * is centered. The value returned is the one read during the last update() that sampled the axis.
   *
   * \see getJoystickDirection() for the relative axis position only.
   *
@@ -194,53 +1234,531 @@ class MD_Gamepad
   */
   int16_t getJoystickValue(switch_t sw)
   {
-    if (millis() - _timeLastAnalog < _timeBetweenReads)
-      return(sw == SW_X ? _valueX : _valueY); // return last read value
-    _timeLastAnalog = millis();
+    channel_t ch = swChannel(sw);
 
-    switch (sw)
-    {
-    case SW_X: 
-      _valueX = analogRead(PIN_X) - _offsetX; 
-      if (abs(_valueX) < _deadband) _valueX = 0;
-      return(_valueX);
+    return(ch == CH_DIGITAL ? 0 : _value[ch - CH_X]);
+  }
 
-    case SW_Y: 
-      _valueY = analogRead(PIN_Y) - _offsetY; 
-      if (abs(_valueY) < _deadband) _valueY = 0;
-      return(_valueY);
-    }
+  /**
+  * Get the joystick magnitude.
+  *
+  * The distance of the joystick from the center, calculated from the X and Y 
+  * values read in the same update(). Full deflection on a diagonal can give a 
+  * magnitude greater than full deflection on one axis.
+  *
+  * \return The joystick magnitude, in the same units as getJoystickValue().
+  */
+  inline uint16_t getJoystickMagnitude(void) { return(_magnitude); }
+
+  /**
+  * Get the joystick angle.
+  *
+  * The direction of the joystick, calculated from the X and Y values read in the 
+  * same update(). The angle is in binary angle units, where 65536 is the full 
+  * circle, starting at the positive X axis and increasing towards the positive 
+  * Y axis (0x4000 is 90 degrees). The angle is 0 when the joystick is centered.
+  *
+  * \return The joystick angle.
+  */
+  inline uint16_t getJoystickAngle(void) { return(_angle); }
+
+  /**
+  * Get the quantized joystick direction.
+  *
+  * The joystick angle quantized to one of 4, 8 or 16 equal sectors (see 
+  * setDirectionWays()). Sector 0 is centered on the positive X axis and the 
+  * sector numbers increase towards the positive Y axis, so for 8 ways sector 2 
+  * is positive Y, 4 is negative X and 6 is negative Y.
+  *
+  * \return The sector number, or MD_GamepadSector::CENTER if the joystick is centered.
+  */
+  inline uint8_t getJoystickSector(void) { return(_sector.get()); }
 
-    return(0);
+ /**
+   * Set the number of joystick directions.
+   *
+   * Set the number of sectors used by getJoystickSector(). The value is 
+   * initialized to DEFAULT_WAYS.
+   *
+   * \param ways the number of directions, 4, 8 or 16.
+   * \return No return value.
+   */
+  inline void setDirectionWays(uint8_t ways) { _sector.setWays(ways); }
+
+ /**
+   * Set the joystick direction hysteresis.
+   *
+   * The joystick must move this far past a sector boundary before the direction 
+   * returned by getJoystickSector() changes, so the direction does not chatter 
+   * when the joystick is held near a boundary. The hysteresis is limited to a 
+   * quarter of the sector width and is initialized to DEFAULT_HYST.
+   *
+   * \param degrees the hysteresis in degrees.
+   * \return No return value.
+   */
+  inline void setDirectionHysteresis(uint8_t degrees) { _sector.setHysteresis(degrees); }
+
+ /**
+   * Set the joystick axis direction thresholds.
+   *
+   * The direction of an axis engages when the value reaches the engage threshold and 
+   * releases back to 0 only when the value falls to the release threshold, so noise 
+   * near a threshold does not make the direction chatter. The thresholds are in the 
+   * same units as getJoystickValue() and are applied after the deadband.
+   * 
+   * The release threshold is limited to less than the engage threshold. The thresholds 
+   * are initialized to engage 1 and release 0, so any value outside the deadband 
+   * engages the direction.
+   *
+   * \param sw      the switch_t value for the analog axis (SW_X or SW_Y).
+   * \param dir     the direction, 1 for the positive or -1 for the negative side of the axis.
+   * \param engage  the value at which the direction engages.
+   * \param release the value at which the direction releases.
+   * \return No return value.
+   */
+  void setDirectionThresholds(switch_t sw, int8_t dir, uint16_t engage, uint16_t release)
+  {
+    uint8_t i = (sw == SW_Y ? 1 : 0);
+    uint8_t d = (dir > 0 ? 1 : 0);
+
+    _engage[i][d] = (engage == 0 ? 1 : engage);
+    _release[i][d] = (release >= _engage[i][d] ? _engage[i][d] - 1 : release);
+  }
+
+ /**
+   * Set the joystick axis direction thresholds for both sides of an axis.
+   *
+   * \sa setDirectionThresholds(switch_t, int8_t, uint16_t, uint16_t)
+   *
+   * \param sw      the switch_t value for the analog axis (SW_X or SW_Y).
+   * \param engage  the value at which the direction engages.
+   * \param release the value at which the direction releases.
+   * \return No return value.
+   */
+  void setDirectionThresholds(switch_t sw, uint16_t engage, uint16_t release)
+  {
+    setDirectionThresholds(sw, 1, engage, release);
+    setDirectionThresholds(sw, -1, engage, release);
   }
   
   private:
-    // One element of the pin to switch ID table
-    struct pin2sw_t
-    {
-      uint8_t pin;  // hardware pin
-      switch_t sw;  // the switch ID
-    };
+    // Independently timed input channels
+    enum channel_t { CH_DIGITAL, CH_X, CH_Y, CH_SCAN, CH_COUNT };
+
+    // Auto repeat inputs: the switches SW_A to SW_K, then X+, X-, Y+ and Y-
+    static const uint8_t RPT_AXIS = SW_K - SW_A + 1;          // first joystick direction input
+    static const uint8_t RPT_COUNT = RPT_AXIS + 4;            // number of inputs
+    static const uint16_t RPT_SWITCHES = (1 << RPT_AXIS) - 1; // bitmap of the switch inputs
+    static_assert(Config::Repeat::INPUTS >= RPT_COUNT, "Repeat needs REPEAT_INPUTS inputs");
+
+    // Switch gesture classifier
+    typedef typename Config::Gesture classifier_t;
+    static_assert(classifier_t::INPUTS >= SW_K - SW_A + 1, "Gesture needs GESTURE_INPUTS inputs");
 
-    // Define lookup table for digital pin to switch ID
-    pin2sw_t _pinDigital[7] = 
+    // Map a switch_t to the channel that reads it
+    static inline channel_t swChannel(switch_t sw) 
     { 
-      { PIN_A, SW_A }, { PIN_B, SW_B }, { PIN_C, SW_C }, 
-      { PIN_D, SW_D }, { PIN_E, SW_E }, { PIN_F, SW_F }, 
-      { PIN_K, SW_K } 
-    };
-
-  // Time value and preset
-  uint32_t _timeLastDigital;   ///< millis() saved value for last digitals processing
-  uint32_t _timeLastAnalog;    ///< millis() saved value for analog processing
-  uint16_t _timeBetweenReads;  ///< in milliseconds
-
-  // Analog joystick handling
-  uint8_t  _deadband;  ///< deadband for analog zero conditioning
-  uint16_t _offsetX;    ///< the joystick offset for the X axis
-  uint16_t _offsetY;    ///< the joystick offset for the Y axis
-  int16_t _valueX;      ///< the adjusted value for the X axis
-  int16_t _valueY;      ///< the adjusted value for the Y axis
+      return(sw == SW_X ? CH_X : (sw == SW_Y ? CH_Y : CH_DIGITAL)); 
+    }
+
+    // Check if the read delay for the channel has expired and 
+    // restart the channel timer if it has.
+    bool isReadDue(channel_t ch, uint32_t now)
+    {
+      if (now - _timeLastRead[ch] < _timeBetweenReads[ch])
+        return(false);
+      _timeLastRead[ch] = now;
+
+      return(true);
+    }
+
+    // Read the analog axis for the channel, dt milliseconds after the last 
+    // read, and save the zero adjusted and filtered value
+    void readAxis(channel_t ch, uint16_t dt)
+    {
+      uint8_t i = ch - CH_X;
+      uint8_t shift = MAX_OVERSAMPLE - _oversample;
+      uint16_t raw = readRaw(i);
+      calib_t &c = _cal[i];
+      int32_t v;
+
+      if (_calibrating)
+      {
+        uint16_t r = raw << shift;
+
+        if (r < c.min) c.min = r;
+        if (r > c.max) c.max = r;
+      }
+
+      if (_outRange == 0)
+        v = (int32_t)raw - (c.center >> shift);
+      else
+        v = normalize(i, (int32_t)(raw << shift) - c.center);
+
+      v = (v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : v));
+      _axis[i] = (i == 0 ? _filterX.filter(v, dt) : _filterY.filter(v, dt));
+    }
+
+    // Apply the deadzone to the filtered axis values, either on each axis 
+    // or radially to both together, and then the response curves
+    void conditionAxes(void)
+    {
+      int16_t v[2] = { _axis[0], _axis[1] };
+
+      if (_stick.isEnabled())
+        _stick.apply(v[0], v[1]);
+      else
+      {
+        for (uint8_t i = 0; i < 2; i++)
+          if (v[i] < (int32_t)_deadband && v[i] > -(int32_t)_deadband) v[i] = 0;
+      }
+
+      for (uint8_t i = 0; i < 2; i++)
+        _value[i] = _curve[i].apply(v[i]);
+
+      // polar form of the conditioned position
+      bool centered = (_value[0] == 0 && _value[1] == 0);
+
+      uint32_t ax = (_value[0] < 0 ? -(int32_t)_value[0] : _value[0]);
+      uint32_t ay = (_value[1] < 0 ? -(int32_t)_value[1] : _value[1]);
+
+      _magnitude = MD_GamepadStick::isqrt(ax * ax + ay * ay);   // up to 2 * 32768^2, needs 32 bits unsigned
+      _angle = MD_GamepadStick::atan2(_value[1], _value[0]);
+      _sector.update(_angle, centered);
+    }
+
+    // Get the joystick value at full deflection
+    inline uint16_t fullRange(void) { return(_outRange != 0 ? _outRange : (_oversample >= MAX_OVERSAMPLE ? INT16_MAX : 512 << _oversample)); }
+
+    // Update the stages that depend on the full deflection value
+    void setFullRange(void)
+    {
+      _stick.setRange(fullRange());
+      _curve[0].setRange(fullRange());
+      _curve[1].setRange(fullRange());
+    }
+
+    // Read the oversampled analog value for an axis (10 + _oversample bits)
+    uint16_t readRaw(uint8_t i)
+    {
+#if GAMEPAD_ADC_ISR
+      return(MD_GamepadADC::read(i));
+#else
+      uint8_t pin = (i == 0 ? Config::PIN_X : Config::PIN_Y);
+      uint32_t sum = 0;
+
+      for (uint16_t k = (1 << (2 * _oversample)); k > 0; k--)
+        sum += analogRead(pin);
+
+      return(sum >> _oversample);
+#endif
+    }
+
+    // Scale the deviation d from the center (left justified 16 bits) of axis i
+    // to the output range, using the reciprocal for that half of the axis.
+    int32_t normalize(uint8_t i, int32_t d)
+    {
+      bool neg = (d < 0);
+      uint32_t m = (neg ? -d : d);
+      uint16_t span = (neg ? _cal[i].center - _cal[i].min : _cal[i].max - _cal[i].center);
+
+      if (m > span) m = span;   // saturate outside the calibrated travel
+      m = (m * _scale[i][neg]) >> 16;
+      if (m > _outRange) m = _outRange;
+
+      return(neg ? -(int32_t)m : (int32_t)m);
+    }
+
+    // Precompute the Q16 reciprocals used to scale each half of axis i. 
+    // As the deviation is saturated at the span, the product fits in 32 bits.
+    void setScale(uint8_t i)
+    {
+      uint16_t span[2] = { (uint16_t)(_cal[i].max - _cal[i].center), (uint16_t)(_cal[i].center - _cal[i].min) };
+
+      for (uint8_t h = 0; h < 2; h++)
+        _scale[i][h] = (span[h] == 0 ? 0 : (((uint32_t)_outRange << 16) + span[h] - 1) / span[h]);
+      if (!_calibrating)
+        _calPrev[i] = _cal[i];
+    }
+
+    // Read the joystick center for an axis as the average of 16 conversions,
+    // returned left justified in 16 bits (scaled by 1 << MAX_OVERSAMPLE).
+    uint16_t readCenter(uint8_t pin)
+    {
+      uint16_t sum = 0;
+
+      for (uint8_t k = 0; k < 16; k++)
+        sum += analogRead(pin);
+
+      return(sum << (MAX_OVERSAMPLE - 4));
+    }
+
+    // Check if the switches need to be scanned. With pin change capture the 
+    // switches are only scanned after an edge and until the debounce settles.
+    bool isScanNeeded(void)
+    {
+#if GAMEPAD_PCINT
+      if (!MD_GamepadPCINT::changed && (_ct0 & _ct1 & 0xfe) == 0xfe)
+        return(false);
+      MD_GamepadPCINT::changed = false;
+#endif
+      return(true);
+    }
+
+    // Queue the press and release events for the last debounce
+    void queueSwitchEvents(uint32_t now)
+    {
+      uint16_t changed = _stateCurr ^ _statePrev;
+
+      if (changed == 0)
+        return;
+
+      for (uint8_t sw = SW_A; sw <= SW_K; sw++)
+      {
+        uint16_t mask = swBit((switch_t)sw);
+
+        if (changed & mask)
+          queueEvent(now, (_stateCurr & mask) ? MD_GamepadEvent::EV_PRESS : MD_GamepadEvent::EV_RELEASE, sw, 0);
+      }
+    }
+
+    // Update the direction of the axis for the channel with the engage and 
+    // release thresholds, and queue an event if the direction has changed
+    void queueAxisEvent(channel_t ch, uint32_t now)
+    {
+      uint8_t i = ch - CH_X;
+      int16_t v = _value[i];
+      int8_t dir = _dir[i];
+
+      if ((dir > 0 && v <= (int32_t)_release[i][1]) || (dir < 0 && v >= -(int32_t)_release[i][0]))
+        dir = 0;
+      if (dir == 0)
+      {
+        if (v >= (int32_t)_engage[i][1]) dir = 1;
+        else if (v <= -(int32_t)_engage[i][0]) dir = -1;
+      }
+
+      if (dir != _dir[i])
+      {
+        _dir[i] = dir;
+        queueEvent(now, MD_GamepadEvent::EV_AXIS, (ch == CH_X ? SW_X : SW_Y), dir);
+      }
+    }
+
+    // Run the auto repeat on the switch and direction snapshot and queue 
+    // an event for each repeat
+    void updateRepeat(uint32_t now)
+    {
+      uint16_t held = (_stateCurr >> SW_A) & RPT_SWITCHES;
+
+      for (uint8_t i = 0; i < 2; i++)
+        if (_dir[i] != 0)
+          held |= 1 << (RPT_AXIS + 2 * i + (_dir[i] > 0 ? 0 : 1));
+
+      if (_repeat.update(held, now) == 0 || _repeat.repeated() == 0)
+        return;
+
+      uint16_t r = _repeat.repeated();
+
+      for (uint8_t i = 0; i < RPT_COUNT; i++)
+      {
+        if (!(r & (1 << i)))
+          continue;
+        if (i < RPT_AXIS)
+          queueEvent(now, MD_GamepadEvent::EV_REPEAT, SW_A + i, 0);
+        else
+          queueEvent(now, MD_GamepadEvent::EV_REPEAT, SW_X + (i - RPT_AXIS) / 2, (i - RPT_AXIS) & 1 ? -1 : 1);
+      }
+    }
+
+    // Run the combo matcher on the switch and direction snapshot and queue 
+    // an event for each combo matched
+    void updateCombo(uint32_t now)
+    {
+      uint16_t input = _stateCurr;
+
+      if (_dir[0] != 0) input |= (_dir[0] > 0 ? MD_GamepadComboDef::DIR_X_POS : MD_GamepadComboDef::DIR_X_NEG);
+      if (_dir[1] != 0) input |= (_dir[1] > 0 ? MD_GamepadComboDef::DIR_Y_POS : MD_GamepadComboDef::DIR_Y_NEG);
+
+      uint16_t m = _combo.update(now, input);
+
+      for (uint8_t c = 0; m != 0; c++, m >>= 1)
+        if (m & 1)
+          queueEvent(now, MD_GamepadEvent::EV_COMBO, c, 0);
+    }
+
+    // Run the gesture classifier for each switch while any switch has changed
+    // or is part way through a gesture, and queue an event for each gesture
+    void updateGesture(uint32_t now)
+    {
+      if (!_gesture.isEnabled() || (_stateCurr == _statePrev && !_gesture.isActive()))
+        return;
+
+      for (uint8_t sw = SW_A; sw <= SW_K; sw++)
+      {
+        uint16_t d = 0;
+        uint8_t g = _gesture.update(sw - SW_A, _stateCurr & swBit((switch_t)sw), now, d);
+
+        if (g != classifier_t::G_NONE)
+          queueEvent(now, (MD_GamepadEvent::type_t)(MD_GamepadEvent::EV_CLICK + g - classifier_t::G_CLICK), sw, d > INT16_MAX ? INT16_MAX : d);
+      }
+    }
+
+    // Queue one event
+    void queueEvent(uint32_t now, MD_GamepadEvent::type_t type, uint8_t id, int16_t value)
+    {
+      MD_GamepadEvent e;
+
+      e.time = now;
+      e.type = type;
+      e.id = id;
+      e.value = value;
+      _events.push(e);
+    }
+
+    // Compile time digital pin for a switch
+    static constexpr uint8_t swPin(switch_t sw)
+    {
+      return(sw == SW_A ? Config::PIN_A : sw == SW_B ? Config::PIN_B :
+             sw == SW_C ? Config::PIN_C : sw == SW_D ? Config::PIN_D :
+             sw == SW_E ? Config::PIN_E : sw == SW_F ? Config::PIN_F : Config::PIN_K);
+    }
+
+    // True if the configuration has the switches on D2-D8 as on the shield
+    static constexpr bool isShieldLayout(void)
+    {
+      return(Config::PIN_A == 2 && Config::PIN_B == 3 && Config::PIN_C == 4 && Config::PIN_D == 5 &&
+             Config::PIN_E == 6 && Config::PIN_F == 7 && Config::PIN_K == 8);
+    }
+
+    // Compile time port for an ATmega328/168 digital pin, PORT_D for D0-D7, 
+    // PORT_B for D8-D13 and PORT_C for A0-A5, and the bit mask in the port
+    enum { PORT_D, PORT_B, PORT_C, PORT_NONE };
+
+    static constexpr uint8_t pinPort(uint8_t pin) { return(pin < 8 ? PORT_D : pin < 14 ? PORT_B : pin < 20 ? PORT_C : PORT_NONE); }
+    static constexpr uint8_t pinMask(uint8_t pin) { return(1 << (pin < 8 ? pin : pin < 14 ? pin - 8 : pin - 14)); }
+
+    // True if any switch up to and including sw is on the port
+    static constexpr bool usesPort(uint8_t port, uint8_t sw = SW_K)
+    {
+      return(sw != SW_NONE && (pinPort(swPin((switch_t)sw)) == port || usesPort(port, sw - 1)));
+    }
+
+    // True if all the switches are on a port
+    static constexpr bool isPortLayout(void) { return(!usesPort(PORT_NONE)); }
+
+    // Switch index used to unroll the digitalRead() scan at compile time
+    template <uint8_t N> struct swIndex_t {};
+
+    // Read the switches up to and including switch N
+    template <uint8_t N> 
+    uint16_t scanPins(swIndex_t<N>)
+    {
+      uint16_t state = scanPins(swIndex_t<N - 1>());
+
+      if (digitalRead(swPin((switch_t)N)) == LOW)
+        state |= swBit((switch_t)N);
+
+      return(state);
+    }
+
+    uint16_t scanPins(swIndex_t<SW_NONE>) { return(0); }
+
+    // Extract the switches up to and including switch N from the ports read
+    template <uint8_t N> 
+    static uint16_t scanPorts(swIndex_t<N>, const uint8_t *port)
+    {
+      uint16_t state = scanPorts(swIndex_t<N - 1>(), port);
+
+      if (!(port[pinPort(swPin((switch_t)N))] & pinMask(swPin((switch_t)N))))
+        state |= swBit((switch_t)N);
+
+      return(state);
+    }
+
+    static uint16_t scanPorts(swIndex_t<SW_NONE>, const uint8_t *) { return(0); }
+
+    // Read all the digital switches into a bitmap with bit swBit(switch_t) 
+    // set for every active (LOW) switch.
+    uint16_t readSwitches(void)
+    {
+#if GAMEPAD_PORT_IO
+      if (isShieldLayout())
+      {
+        // D2-D7 are PD2-PD7 and map to bits 1-6 (SW_A-SW_F), D8 is PB0 and maps to bit 7 (SW_K)
+        uint16_t state = ((uint8_t)~PIND >> 1) & 0x7e;
+
+        state |= ((uint8_t)~PINB & 0x01) << 7;
+        return(state);
+      }
+      if (isPortLayout())
+      {
+        // read each port used once, then test each switch bit
+        uint8_t port[3];
+
+        port[PORT_D] = (usesPort(PORT_D) ? PIND : 0);
+        port[PORT_B] = (usesPort(PORT_B) ? PINB : 0);
+        port[PORT_C] = (usesPort(PORT_C) ? PINC : 0);
+        return(scanPorts(swIndex_t<SW_K>(), port));
+      }
+#endif
+      return(scanPins(swIndex_t<SW_K>()));
+    }
+
+    // Debounce all the switches in parallel using 2 bit vertical counters.
+    // Each bit position in _ct1:_ct0 is a counter for the switch in the same 
+    // bit position, reset while the sample matches the debounced state and 
+    // counting on every sample that differs. The debounced state toggles 
+    // when the counter rolls over after 4 consecutive differing samples.
+    uint16_t debounce(uint16_t sample)
+    {
+      uint8_t delta = (uint8_t)sample ^ (uint8_t)_stateCurr;
+
+      _ct0 = ~(_ct0 & delta);
+      _ct1 = _ct0 ^ (_ct1 & delta);
+      delta &= _ct0 & _ct1;
+
+      return(_stateCurr ^ delta);
+    }
+
+  // Digital switch snapshots
+  uint16_t _stateCurr;   ///< bitmap of the switches in the current snapshot
+  uint16_t _statePrev;   ///< bitmap of the switches in the previous snapshot
+  uint8_t  _ct0, _ct1;   ///< vertical debounce counters, bit 0 and bit 1
+
+  // Time value and preset for each channel
+  uint32_t _timeLastRead[CH_COUNT];      ///< Clock::millis() saved value for last channel processing
+  uint16_t _timeBetweenReads[CH_COUNT];  ///< in milliseconds
+  uint8_t  _frameRead;                   ///< bit (1 << channel) set if channel read in this update
+
+  // Analog joystick handling, [0] is the X axis and [1] the Y axis
+  uint16_t _deadband;   ///< deadband for analog zero conditioning
+  uint8_t  _oversample; ///< oversampling, 4^n conversions per value
+  calib_t  _cal[2];     ///< the calibration for each axis
+  calib_t  _calPrev[2]; ///< the calibration to restore if a sweep is rejected
+  uint32_t _scale[2][2];///< Q16 reciprocals for each axis, [0] positive and [1] negative half
+  uint16_t _outRange;   ///< normalized output range, 0 for no normalization
+  bool     _calibrating;///< true during a calibration sweep
+  int16_t _axis[2];     ///< the filtered value for each axis
+  int16_t _value[2];    ///< the adjusted value for each axis
+  int8_t  _dir[2];      ///< the current direction of each axis
+  uint16_t _engage[2][2];  ///< direction engage threshold for each axis, [0] negative and [1] positive side
+  uint16_t _release[2][2]; ///< direction release threshold for each axis, [0] negative and [1] positive side
+  typename Config::FilterX _filterX;  ///< the X axis filter
+  typename Config::FilterY _filterY;  ///< the Y axis filter
+  MD_GamepadStick _stick;             ///< the radial deadzone stage
+  MD_GamepadCurve _curve[2];          ///< the response curve for each axis
+  MD_GamepadSector _sector;           ///< the quantized joystick direction
+  typename Config::Repeat _repeat;    ///< the auto repeat for switches and joystick directions
+  typename Config::Combo _combo;      ///< the chord and sequence matcher
+  classifier_t _gesture;              ///< the switch gesture classifier
+  uint16_t _magnitude;  ///< the joystick distance from the center
+  uint16_t _angle;      ///< the joystick angle in binary angle units
+
+  // Input events
+  eventQueue_t _events; ///< queue of input events
 };
 
+typedef MD_GamepadT<> MD_Gamepad;   ///< The gamepad object for the default shield configuration
+
 MD_Gamepad gamepad;   ///< A single instance of this hardware declared in the library
@@ -0,0 +1,383 @@
+/*
+MD_Gamepad - Library to encapsulate a Gamepad/Joystick Shield.
+
+See main header file for information.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \file
+ * \brief Chord and sequence (combo) detection for the MD_Gamepad library
+ *
+ * Combos are defined in a table of MD_GamepadComboDef structures by the application:
+ * - a chord is a set of inputs that must all be held together, with the last one
+ *   pressed within the time window of the first.
+ * - a sequence is a list of steps that must be pressed in order, with nothing else
+ *   pressed in between, and the last step pressed within the time window of the first.
+ *
+ * Each step or chord is a bitmap of inputs, the switch bits from MD_GamepadT::swBit()
+ * and the joystick directions DIR_X_POS, DIR_X_NEG, DIR_Y_POS and DIR_Y_NEG:
+ * \code
+ * const MD_GamepadComboDef combos[] =
+ * {
+ *   { MD_GamepadComboDef::CHORD, 100, 1, { MD_Gamepad::swBit(MD_Gamepad::SW_A) | MD_Gamepad::swBit(MD_Gamepad::SW_B) } },
+ *   { MD_GamepadComboDef::SEQUENCE, 300, 3, { MD_GamepadComboDef::DIR_Y_NEG, MD_GamepadComboDef::DIR_Y_NEG, MD_Gamepad::swBit(MD_Gamepad::SW_K) } },
+ * };
+ *
+ * gamepad.setCombos(combos, ARRAY_SIZE(combos));
+ * \endcode
+ *
+ * The table is compiled when it is set into a small state machine for each combo,
+ * so each update only advances the state of each combo and the cost does not
+ * depend on the length of the input history.
+ *
+ * The matcher used by MD_GamepadT is selected by the Combo type in the 
+ * configuration (see MD_GamepadShield). The default MD_GamepadComboNone costs no 
+ * RAM and matches nothing, so a configuration must select MD_GamepadCombo to 
+ * use combos.
+ */
+
+#ifndef COMBO_STEPS
+#define COMBO_STEPS   6   ///< Maximum number of steps in a sequence
+#endif
+
+#ifndef COMBO_MAX
+#define COMBO_MAX     8   ///< Maximum number of combos in a table, up to 16
+#endif
+
+#ifndef HISTORY_SIZE
+#define HISTORY_SIZE  8   ///< Number of entries in the input history, at least COMBO_STEPS
+#endif
+
+/**
+ * Combo definition.
+ */
+struct MD_GamepadComboDef
+{
+  /**
+   * Combo type enumerated type.
+   */
+  enum type_t : uint8_t
+  {
+    CHORD,      ///< inputs held together
+    SEQUENCE,   ///< inputs pressed in order
+  };
+
+  /**
+   * Input bits for the joystick directions.
+   */
+  enum : uint16_t
+  {
+    DIR_X_POS = 0x1000,   ///< joystick X axis positive direction
+    DIR_X_NEG = 0x2000,   ///< joystick X axis negative direction
+    DIR_Y_POS = 0x4000,   ///< joystick Y axis positive direction
+    DIR_Y_NEG = 0x8000,   ///< joystick Y axis negative direction
+  };
+
+  type_t   type;               ///< the type of combo
+  uint16_t window;             ///< time from the first to the last input in milliseconds
+  uint8_t  length;             ///< the number of steps, 1 for a chord
+  uint16_t step[COMBO_STEPS];  ///< the input bitmap for each step
+};
+
+/**
+ * Input history.
+ *
+ * A ring holding the most recent updates in which new inputs were pressed.
+ */
+class MD_GamepadHistory
+{
+  public:
+  /**
+   * One history entry.
+   */
+  struct entry_t
+  {
+    uint16_t time;     ///< time of the update, low 16 bits of the milliseconds
+    uint16_t pressed;  ///< bitmap of the inputs newly pressed in the update
+  };
+
+  /**
+   * Clear the history.
+   */
+  inline void begin(void) { _head = _count = 0; }
+
+  /**
+   * Add an entry to the history, replacing the oldest entry if it is full.
+   *
+   * \param time    the time of the update.
+   * \param pressed the inputs newly pressed.
+   */
+  void push(uint16_t time, uint16_t pressed)
+  {
+    _head = (_head + 1) % HISTORY_SIZE;
+    _buf[_head].time = time;
+    _buf[_head].pressed = pressed;
+    if (_count < HISTORY_SIZE) _count++;
+  }
+
+  /**
+   * Get an entry from the history.
+   *
+   * \param n the entry, 0 for the newest.
+   * \param e the variable to receive the entry.
+   * \return true if the entry exists.
+   */
+  bool get(uint8_t n, entry_t &e) const
+  {
+    if (n >= _count)
+      return(false);
+    e = _buf[(_head + HISTORY_SIZE - n) % HISTORY_SIZE];
+
+    return(true);
+  }
+
+  private:
+  entry_t _buf[HISTORY_SIZE];   ///< the entries
+  uint8_t _head;                ///< the newest entry
+  uint8_t _count;               ///< the number of entries
+};
+
+/**
+ * Chord and sequence matcher.
+ *
+ * Sequences are compiled into the failure links of a Knuth-Morris-Pratt matcher,
+ * so when a press does not continue a partly matched sequence the matcher falls
+ * back to the longest part still matched, without scanning the history. The
+ * history is only used to find the time of the first press of that part.
+ */
+class MD_GamepadCombo
+{
+  static_assert(COMBO_MAX <= 16, "COMBO_MAX must be no more than 16");
+  static_assert(HISTORY_SIZE >= COMBO_STEPS, "HISTORY_SIZE must be at least COMBO_STEPS");
+
+  public:
+  /**
+   * Initialize with no combos.
+   */
+  void begin(void)
+  {
+    _def = nullptr;
+    _count = 0;
+    _matched = _held = 0;
+    _history.begin();
+  }
+
+  /**
+   * Set the combo table and compile the state machines.
+   *
+   * The table is not copied and must remain valid while it is in use.
+   *
+   * \param def   the combo table.
+   * \param count the number of combos in the table, up to COMBO_MAX.
+   */
+  void set(const MD_GamepadComboDef *def, uint8_t count)
+  {
+    _def = def;
+    _count = (count > COMBO_MAX ? COMBO_MAX : count);
+
+    for (uint8_t c = 0; c < _count; c++)
+    {
+      const uint16_t *s = _def[c].step;
+      uint8_t len = (_def[c].length > COMBO_STEPS ? COMBO_STEPS : _def[c].length);
+
+      _state[c] = 0;
+
+      // fail[k] is the longest proper prefix of step[0..k-1] that is also its suffix
+      _fail[c][0] = _fail[c][1] = 0;
+      for (uint8_t k = 1, f = 0; k < len; k++)
+      {
+        while (f > 0 && s[k] != s[f]) f = _fail[c][f];
+        if (s[k] == s[f]) f++;
+        _fail[c][k + 1] = f;
+      }
+    }
+  }
+
+  /**
+   * Update the matcher.
+   *
+   * Combos only advance when the inputs change, so nothing is done while the 
+   * inputs held are the same as in the last update.
+   *
+   * \param now  the current time in milliseconds.
+   * \param held bitmap of the inputs held.
+   * \return bitmap of the combos matched, bit n for combo n in the table.
+   */
+  uint16_t update(uint16_t now, uint16_t held)
+  {
+    uint16_t pressed = held & ~_held;
+
+    _matched = 0;
+    if (held == _held)
+      return(0);
+    _held = held;
+
+    if (pressed != 0)
+      _history.push(now, pressed);
+
+    for (uint8_t c = 0; c < _count; c++)
+    {
+      if (_def[c].type == MD_GamepadComboDef::CHORD)
+        updateChord(c, now, held);
+      else if (pressed != 0)
+        updateSequence(c, now, pressed);
+    }
+
+    return(_matched);
+  }
+
+  /**
+   * Get the combos matched in the last update.
+   *
+   * \return bitmap of the combos matched, bit n for combo n in the table.
+   */
+  inline uint16_t matched(void) const { return(_matched); }
+
+  /**
+   * Get the input history.
+   *
+   * \return the input history.
+   */
+  inline const MD_GamepadHistory &history(void) const { return(_history); }
+
+  private:
+  // Chord states
+  enum { CHORD_IDLE, CHORD_WAIT, CHORD_DONE };
+
+  const MD_GamepadComboDef *_def;            ///< the combo table
+  uint8_t  _count;                           ///< the number of combos in the table
+  uint8_t  _state[COMBO_MAX];                ///< chord state or number of sequence steps matched
+  uint8_t  _fail[COMBO_MAX][COMBO_STEPS + 1];///< sequence failure links
+  uint16_t _start[COMBO_MAX];                ///< time the first chord input was pressed
+  uint16_t _matched;                         ///< bitmap of the combos matched in the last update
+  uint16_t _held;                            ///< bitmap of the inputs held in the last update
+  MD_GamepadHistory _history;                ///< recent presses
+
+  // Advance a chord. A chord must be completed within the window and is
+  // reported once, then not again until all its inputs are released.
+  void updateChord(uint8_t c, uint16_t now, uint16_t held)
+  {
+    uint16_t mask = _def[c].step[0];
+    uint16_t h = held & mask;
+
+    if (h == 0)
+      _state[c] = CHORD_IDLE;
+    else if (_state[c] == CHORD_IDLE)
+    {
+      _state[c] = CHORD_WAIT;
+      _start[c] = now;
+    }
+
+    if (_state[c] == CHORD_WAIT)
+    {
+      if ((uint16_t)(now - _start[c]) > _def[c].window)
+        _state[c] = CHORD_DONE;
+      else if (h == mask)
+      {
+        _matched |= (1 << c);
+        _state[c] = CHORD_DONE;
+      }
+    }
+  }
+
+  // Advance a sequence on a new press
+  void updateSequence(uint8_t c, uint16_t now, uint16_t pressed)
+  {
+    const MD_GamepadComboDef &d = _def[c];
+    uint8_t len = (d.length > COMBO_STEPS ? COMBO_STEPS : d.length);
+    uint8_t k = _state[c];
+    MD_GamepadHistory::entry_t e;
+
+    if (len == 0)
+      return;
+
+    // follow the failure links until the press continues the match
+    for (;;)
+    {
+      if ((pressed & d.step[k]) == d.step[k])
+      {
+        k++;
+        break;
+      }
+      if (k == 0)
+        break;
+      k = _fail[c][k];
+    }
+
+    // drop the oldest matched steps while the first is outside the window
+    while (k > 0 && _history.get(k - 1, e) && (uint16_t)(now - e.time) > d.window)
+      k = _fail[c][k];
+
+    if (k == len)
+    {
+      _matched |= (1 << c);
+      k = 0;
+    }
+    _state[c] = k;
+  }
+};
+
+/**
+ * No combo matching.
+ *
+ * The same interface as MD_GamepadCombo with no combo table or input history.
+ * Nothing is ever matched.
+ */
+class MD_GamepadComboNone
+{
+  public:
+  /**
+   * Empty input history.
+   */
+  struct history_t
+  {
+    /**
+     * Get an entry from the history.
+     *
+     * \param n the entry.
+     * \param e the variable to receive the entry.
+     * \return false as the history is always empty.
+     */
+    inline bool get(uint8_t n, MD_GamepadHistory::entry_t &e) const { (void)n; (void)e; return(false); }
+  };
+
+  /**
+   * Initialize with no combos.
+   */
+  inline void begin(void) {}
+
+  /**
+   * Set the combo table, which is ignored.
+   *
+   * \param def   the combo table.
+   * \param count the number of combos in the table.
+   */
+  inline void set(const MD_GamepadComboDef *def, uint8_t count) { (void)def; (void)count; }
+
+  /**
+   * Update the matcher.
+   *
+   * \param now  the current time in milliseconds.
+   * \param held bitmap of the inputs held.
+   * \return 0 as nothing is matched.
+   */
+  inline uint16_t update(uint16_t now, uint16_t held) { (void)now; (void)held; return(0); }
+
+  /**
+   * Get the combos matched in the last update.
+   *
+   * \return 0 as nothing is matched.
+   */
+  inline uint16_t matched(void) const { return(0); }
+
+  /**
+   * Get the input history.
+   *
+   * \return an empty input history.
+   */
+  inline history_t history(void) const { return(history_t()); }
+};
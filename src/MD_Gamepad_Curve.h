@@ -0,0 +1,170 @@
+/*
+MD_Gamepad - Library to encapsulate a Gamepad/Joystick Shield.
+
+See main header file for information.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \file
+ * \brief Joystick response curves for the MD_Gamepad library
+ *
+ * A response curve maps the joystick deflection to the output value, for example
+ * to give fine control near the center and fast movement at the edges. Curves are
+ * tables of GAMEPAD_CURVE_POINTS points in program memory, computed by the compiler
+ * from constexpr curve functions, so applying a curve at run time costs a table
+ * lookup and a linear interpolation between two points.
+ *
+ * Each point is the output for deflections 0, 1/32, 2/32 ... 1 of full deflection,
+ * scaled so full deflection is 32768. The curves are odd symmetric, so the same
+ * table is used for both directions of an axis.
+ *
+ * A table is defined with the GAMEPAD_CURVE macro, giving the table name, the
+ * curve function and its parameters after the point index:
+ * \code
+ * GAMEPAD_CURVE(curveSoft, curveExpo, 40, 100);  // 40% expo, full rate
+ * GAMEPAD_CURVE(curveSlow, curveExpo, 40, 50);   // 40% expo, half rate
+ * GAMEPAD_CURVE(curveSmooth, curveS, 100, 100);  // S curve
+ *
+ * gamepad.setCurve(MD_Gamepad::SW_X, curveSoft);
+ * \endcode
+ * Any constexpr function taking the point index (0 to 32) as the first parameter
+ * and returning the point value can be used as the curve function.
+ */
+
+#define GAMEPAD_CURVE_POINTS 33   ///< Number of points in a curve table, for 32 intervals
+
+/**
+ * Define a curve table in program memory.
+ *
+ * \param name the table name.
+ * \param f    the constexpr curve function.
+ * \param ...  the parameters passed to f after the point index.
+ */
+#define GAMEPAD_CURVE(name, f, ...) \
+  static const uint16_t name[GAMEPAD_CURVE_POINTS] PROGMEM = \
+  { \
+    GAMEPAD_CURVE8(0, f, __VA_ARGS__), GAMEPAD_CURVE8(8, f, __VA_ARGS__), \
+    GAMEPAD_CURVE8(16, f, __VA_ARGS__), GAMEPAD_CURVE8(24, f, __VA_ARGS__), \
+    f(32, __VA_ARGS__) \
+  }
+
+/// 8 curve table points starting at point n, used by GAMEPAD_CURVE
+#define GAMEPAD_CURVE8(n, f, ...) \
+  f(n, __VA_ARGS__), f(n+1, __VA_ARGS__), f(n+2, __VA_ARGS__), f(n+3, __VA_ARGS__), \
+  f(n+4, __VA_ARGS__), f(n+5, __VA_ARGS__), f(n+6, __VA_ARGS__), f(n+7, __VA_ARGS__)
+
+/**
+ * Limit a curve point to the range 0 to 32768.
+ *
+ * \param v the point value.
+ * \return the limited value.
+ */
+constexpr uint16_t curveLimit(int32_t v) { return(v < 0 ? 0 : (v > 32768 ? 32768 : v)); }
+
+/**
+ * Exponential (expo) and rate curve.
+ *
+ * The cubic blend used for RC transmitter expo, y = rate * ((1 - expo) * x + expo * x^3).
+ * Expo 0 is linear and expo 100 is a pure cubic. Rates below 100 reduce the output
+ * at full deflection (dual rate); rates above 100 saturate before full deflection.
+ *
+ * \param i    the point index, 0 to 32.
+ * \param expo the expo in percent, 0 to 100.
+ * \param rate the rate in percent, 0 to 200.
+ * \return the point value.
+ */
+constexpr uint16_t curveExpo(uint8_t i, uint8_t expo, uint8_t rate)
+{
+  return(curveLimit((int32_t)rate * ((100 - expo) * i * 1024L + (int32_t)expo * i * i * i) / 10000));
+}
+
+/**
+ * S curve.
+ *
+ * A blend of linear and the smoothstep curve 3x^2 - 2x^3, which is flat near the
+ * center and near full deflection and steepest in between.
+ *
+ * \param i    the point index, 0 to 32.
+ * \param s    the amount of S curve in percent, 0 (linear) to 100.
+ * \param rate the rate in percent, 0 to 200.
+ * \return the point value.
+ */
+constexpr uint16_t curveS(uint8_t i, uint8_t s, uint8_t rate)
+{
+  return(curveLimit((int32_t)rate * ((100 - s) * i * 1024L + (int32_t)s * (96L * i * i - 2L * i * i * i)) / 10000));
+}
+
+/**
+ * Response curve stage for one axis.
+ *
+ * Holds a pointer to the curve table in use, which can be changed at any time,
+ * and the precomputed scale from axis units to table position.
+ */
+class MD_GamepadCurve
+{
+  public:
+  /**
+   * Initialize the stage with no curve (linear response).
+   *
+   * \param full the axis value at full deflection.
+   */
+  void begin(uint16_t full) { _table = nullptr; setRange(full); }
+
+  /**
+   * Set the curve table.
+   *
+   * \param table the curve table in program memory, nullptr for a linear response.
+   */
+  inline void setTable(const uint16_t *table) { _table = table; }
+
+  /**
+   * Set the full deflection value.
+   *
+   * \param full the axis value at full deflection.
+   */
+  void setRange(uint16_t full)
+  {
+    _full = (full == 0 ? 1 : full);
+    _k = (((uint32_t)(GAMEPAD_CURVE_POINTS - 1) << 24) + _full - 1) / _full;
+  }
+
+  /**
+   * Apply the curve to an axis value.
+   *
+   * \param v the axis value.
+   * \return the value after the curve.
+   */
+  int16_t apply(int16_t v) const
+  {
+    if (_table == nullptr)
+      return(v);
+
+    uint16_t a = (v < 0 ? -(int32_t)v : v);
+
+    if (a > _full) a = _full;
+
+    // table position with 8 fractional bits
+    uint16_t p = ((uint32_t)a * _k) >> 16;
+    uint8_t idx = p >> 8;
+    uint32_t y = pgm_read_word(&_table[idx]);
+
+    if (idx < GAMEPAD_CURVE_POINTS - 1)
+    {
+      int32_t d = (int32_t)pgm_read_word(&_table[idx + 1]) - y;
+
+      y += (d * (p & 0xff)) >> 8;
+    }
+    y = (y * _full + 0x4000) >> 15;
+
+    return(v < 0 ? -(int16_t)y : (int16_t)y);
+  }
+
+  private:
+  const uint16_t *_table;  ///< the curve table in program memory, or nullptr
+  uint16_t _full;          ///< axis value at full deflection
+  uint32_t _k;             ///< Q16 scale from axis units to table position in 1/256 intervals
+};
@@ -0,0 +1,246 @@
+/*
+MD_Gamepad - Library to encapsulate a Gamepad/Joystick Shield.
+
+See main header file for information.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \file
+ * \brief Joystick axis filters for the MD_Gamepad library
+ *
+ * The filters condition the zero adjusted joystick axis values before the deadband
+ * is applied. All the filters use integer or fixed point arithmetic only, and are
+ * selected at compile time in the pin configuration structure (see MD_GamepadShield),
+ * so filters that are not used cost no program memory.
+ *
+ * Each filter class provides the same two methods:
+ * - `void reset(int16_t x)` to set the filter state to a value.
+ * - `int16_t filter(int16_t x, uint16_t dt)` to filter the next sample x, taken
+ *   dt milliseconds after the previous one, and return the filtered value.
+ *
+ * Filters are combined in a pipeline using MD_GamepadFilterChain.
+ */
+
+/**
+ * Pass through filter.
+ *
+ * The default filter, returns the samples unchanged.
+ */
+struct MD_GamepadFilterNone
+{
+  /**
+   * Reset the filter state.
+   *
+   * \param x the value to reset to.
+   */
+  inline void reset(int16_t x) { (void)x; }
+
+  /**
+   * Filter the next sample.
+   *
+   * \param x  the sample.
+   * \param dt the time in milliseconds since the last sample.
+   * \return the filtered value.
+   */
+  inline int16_t filter(int16_t x, uint16_t dt) { (void)dt; return(x); }
+};
+
+/**
+ * Exponential moving average filter.
+ *
+ * Each sample moves the output 1/2^SHIFT of the way towards the sample. The
+ * output is kept with 8 fractional bits so small movements are not lost.
+ *
+ * \tparam SHIFT the smoothing, larger values smooth more and lag more (1 to 7).
+ */
+template <uint8_t SHIFT = 2>
+class MD_GamepadFilterEMA
+{
+  static_assert(SHIFT >= 1 && SHIFT <= 7, "EMA SHIFT must be 1 to 7");
+
+  public:
+  /**
+   * Reset the filter state.
+   *
+   * \param x the value to reset to.
+   */
+  inline void reset(int16_t x) { _y = (int32_t)x << 8; }
+
+  /**
+   * Filter the next sample.
+   *
+   * \param x  the sample.
+   * \param dt the time in milliseconds since the last sample.
+   * \return the filtered value.
+   */
+  int16_t filter(int16_t x, uint16_t dt)
+  {
+    (void)dt;
+    _y += (((int32_t)x << 8) - _y) >> SHIFT;
+
+    return((_y + 0x80) >> 8);
+  }
+
+  private:
+  int32_t _y;   ///< the output, 8 fractional bits
+};
+
+/**
+ * Median of 3 filter.
+ *
+ * The output is the median of the last 3 samples, which removes single
+ * sample spikes completely with only one sample of delay.
+ */
+class MD_GamepadFilterMedian3
+{
+  public:
+  /**
+   * Reset the filter state.
+   *
+   * \param x the value to reset to.
+   */
+  inline void reset(int16_t x) { _x1 = _x2 = x; }
+
+  /**
+   * Filter the next sample.
+   *
+   * \param x  the sample.
+   * \param dt the time in milliseconds since the last sample.
+   * \return the filtered value.
+   */
+  int16_t filter(int16_t x, uint16_t dt)
+  {
+    int16_t a = _x2, b = _x1, c = x;
+
+    (void)dt;
+    _x2 = _x1;
+    _x1 = x;
+
+    if (a > b) { int16_t t = a; a = b; b = t; }  // now a <= b
+    if (c < b) b = (c > a ? c : a);
+
+    return(b);
+  }
+
+  private:
+  int16_t _x1;  ///< the previous sample
+  int16_t _x2;  ///< the sample before the previous one
+};
+
+/**
+ * One Euro adaptive filter.
+ *
+ * A first order low pass filter whose cutoff frequency rises with the speed of
+ * the input, so the output is strongly smoothed when the joystick is at rest
+ * and follows quickly, with little lag, when it moves fast. See Casiez, Roussel
+ * and Vogel, "1 Euro Filter", CHI 2012.
+ *
+ * The filter runs in fixed point. Frequencies are in units of 0.01Hz. The speed
+ * of the input is in axis units per second and the cutoff frequency is
+ * MIN_CUTOFF + (BETA * |speed|) / 256.
+ *
+ * \tparam MIN_CUTOFF cutoff frequency at rest, in 0.01Hz (default 1Hz).
+ * \tparam BETA       cutoff increase with speed, in 0.01Hz per 256 units/s.
+ * \tparam D_CUTOFF   cutoff frequency for the speed estimate, in 0.01Hz (default 1Hz).
+ */
+template <uint16_t MIN_CUTOFF = 100, uint16_t BETA = 500, uint16_t D_CUTOFF = 100>
+class MD_GamepadFilterOneEuro
+{
+  public:
+  /**
+   * Reset the filter state.
+   *
+   * \param x the value to reset to.
+   */
+  inline void reset(int16_t x) { _y = (int32_t)x << 8; _dx = 0; _xPrev = x; }
+
+  /**
+   * Filter the next sample.
+   *
+   * \param x  the sample.
+   * \param dt the time in milliseconds since the last sample.
+   * \return the filtered value.
+   */
+  int16_t filter(int16_t x, uint16_t dt)
+  {
+    if (dt == 0) dt = 1;
+    if (dt > 255) dt = 255;
+
+    // filtered speed of the input in units/s
+    int32_t dx = (((int32_t)x - _xPrev) * 1000) / dt;
+
+    _xPrev = x;
+    _dx += mulQ15(dx - _dx, alpha(D_CUTOFF, dt));
+
+    // adaptive cutoff, saturated at 655Hz, and filtered output
+    uint32_t speed = (uint32_t)(_dx < 0 ? -_dx : _dx) >> 8;
+    uint32_t cutoff = MIN_CUTOFF;
+
+    if (BETA != 0)
+      cutoff = (speed > (UINT16_MAX - MIN_CUTOFF) / BETA) ? UINT16_MAX : cutoff + speed * BETA;
+    _y += mulQ15(((int32_t)x << 8) - _y, alpha(cutoff, dt));
+
+    return((_y + 0x80) >> 8);
+  }
+
+  private:
+  int32_t _y;      ///< the output, 8 fractional bits
+  int32_t _dx;     ///< the filtered speed in units/s
+  int16_t _xPrev;  ///< the previous sample
+
+  // Low pass filter coefficient in Q15 for cutoff fc (0.01Hz) and sample time dt (ms).
+  // alpha = r/(1+r) where r = 2*pi*fc*dt, computed as 1 - 1/(1+r) with r scaled by 1e5.
+  static uint16_t alpha(uint16_t fc, uint16_t dt)
+  {
+    uint32_t r = ((uint32_t)fc * dt * 201) >> 5;   // 2*pi ~= 201/32
+
+    return(32768UL - 3276800000UL / (100000UL + r));
+  }
+
+  // Multiply a by the Q15 fraction q, split so the products fit in 32 bits
+  static int32_t mulQ15(int32_t a, uint16_t q)
+  {
+    return((a >> 15) * q + (((a & 0x7fff) * (int32_t)q) >> 15));
+  }
+};
+
+/**
+ * Filter pipeline.
+ *
+ * Applies filter F1 and then filter F2 to each sample. Chains can be nested
+ * to build longer pipelines, for example:
+ * \code
+ * typedef MD_GamepadFilterChain<MD_GamepadFilterMedian3, MD_GamepadFilterOneEuro<> > FilterX;
+ * \endcode
+ *
+ * \tparam F1 the first filter.
+ * \tparam F2 the second filter.
+ */
+template <class F1, class F2>
+class MD_GamepadFilterChain
+{
+  public:
+  /**
+   * Reset the filter state.
+   *
+   * \param x the value to reset to.
+   */
+  inline void reset(int16_t x) { _f1.reset(x); _f2.reset(x); }
+
+  /**
+   * Filter the next sample.
+   *
+   * \param x  the sample.
+   * \param dt the time in milliseconds since the last sample.
+   * \return the filtered value.
+   */
+  inline int16_t filter(int16_t x, uint16_t dt) { return(_f2.filter(_f1.filter(x, dt), dt)); }
+
+  private:
+  F1 _f1;   ///< the first filter
+  F2 _f2;   ///< the second filter
+};
@@ -0,0 +1,230 @@
+/*
+MD_Gamepad - Library to encapsulate a Gamepad/Joystick Shield.
+
+See main header file for information.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \file
+ * \brief Switch gesture classification for the MD_Gamepad library
+ *
+ * The classifier used by MD_GamepadT is selected by the Gesture type in the
+ * configuration (see MD_GamepadShield). The default MD_GamepadGestureNone costs
+ * no RAM and classifies nothing, so a configuration must select MD_GamepadGesture
+ * to use gestures.
+ */
+
+/**
+ * Switch gesture classifier.
+ *
+ * Classifies the presses of up to N switches into gestures:
+ * - click - pressed and released, and not pressed again within the double click time.
+ * - double click - pressed again within the double click time of a click.
+ * - long press - held for the long press time, reported while the switch is still held.
+ * - hold release - released after a long press, with the time the switch was held.
+ *
+ * Each switch uses a state and one time, 3 bytes of RAM, so hold times up to 65s
+ * are measured. The classifier works on the debounced switch states passed to
+ * update(), so times are measured to the update when the debounced state changed.
+ *
+ * \tparam N the number of switches.
+ */
+template <uint8_t N>
+class MD_GamepadGesture
+{
+  public:
+  static const uint8_t INPUTS = N;   ///< the number of switches
+
+  /**
+   * Gesture enumerated type.
+   */
+  enum gesture_t : uint8_t
+  {
+    G_NONE,           ///< no gesture
+    G_CLICK,          ///< single click
+    G_DOUBLE_CLICK,   ///< double click
+    G_LONG_PRESS,     ///< long press time reached, switch still held
+    G_HOLD_RELEASE,   ///< switch released after a long press
+  };
+
+  /**
+   * Initialize the classifier, disabled.
+   */
+  void begin(void)
+  {
+    setTimes(0, 0);
+    for (uint8_t i = 0; i < N; i++)
+      _sw[i].state = S_IDLE;
+  }
+
+  /**
+   * Set the gesture times.
+   *
+   * \param doubleClick the time allowed between a release and the next press for a double click.
+   * \param longPress   the time a switch must be held for a long press, 0 to disable the classifier.
+   */
+  void setTimes(uint16_t doubleClick, uint16_t longPress)
+  {
+    _timeDouble = doubleClick;
+    _timeLong = longPress;
+  }
+
+  /**
+   * Check if the classifier is enabled.
+   *
+   * \return true if the classifier is enabled.
+   */
+  inline bool isEnabled(void) const { return(_timeLong != 0); }
+
+  /**
+   * Check if any switch is being classified.
+   *
+   * \return true if any switch is not idle, so update() must be called even if no switch changed.
+   */
+  bool isActive(void) const
+  {
+    for (uint8_t i = 0; i < N; i++)
+      if (_sw[i].state != S_IDLE)
+        return(true);
+
+    return(false);
+  }
+
+  /**
+   * Update the classifier for one switch.
+   *
+   * \param i        the switch number, 0 to N-1.
+   * \param held     true if the switch is held.
+   * \param now      the current time in milliseconds.
+   * \param duration the variable to receive the hold time for G_HOLD_RELEASE.
+   * \return the gesture detected, G_NONE if none.
+   */
+  gesture_t update(uint8_t i, bool held, uint16_t now, uint16_t &duration)
+  {
+    data_t &s = _sw[i];
+    uint16_t elapsed = now - s.time;
+
+    switch (s.state)
+    {
+    case S_IDLE:
+      if (held) { s.state = S_DOWN; s.time = now; }
+      break;
+
+    case S_DOWN:
+      if (!held) { s.state = S_UP; s.time = now; }
+      else if (elapsed >= _timeLong) { s.state = S_LONG; return(G_LONG_PRESS); }
+      break;
+
+    case S_UP:
+      if (held && elapsed < _timeDouble) { s.state = S_DOWN2; }
+      else if (held || elapsed >= _timeDouble)
+      {
+        // a press after the double click time is the start of a new gesture
+        s.state = (held ? S_DOWN : S_IDLE);
+        s.time = now;
+        return(G_CLICK);
+      }
+      break;
+
+    case S_DOWN2:
+      if (!held) { s.state = S_IDLE; return(G_DOUBLE_CLICK); }
+      break;
+
+    case S_LONG:
+      if (!held)
+      {
+        s.state = S_IDLE;
+        duration = elapsed;
+        return(G_HOLD_RELEASE);
+      }
+      break;
+    }
+
+    return(G_NONE);
+  }
+
+  private:
+  // Switch states
+  enum : uint8_t { S_IDLE, S_DOWN, S_UP, S_DOWN2, S_LONG };
+
+  // Classifier data for one switch
+  struct data_t
+  {
+    uint8_t  state;   ///< the classifier state
+    uint16_t time;    ///< time of the last press or release
+  };
+
+  data_t   _sw[N];       ///< the data for each switch
+  uint16_t _timeDouble;  ///< the double click time in milliseconds
+  uint16_t _timeLong;    ///< the long press time in milliseconds
+};
+
+/**
+ * No gesture classification.
+ *
+ * The same interface as MD_GamepadGesture with no switch data. It is never
+ * enabled and no gestures are detected.
+ */
+class MD_GamepadGestureNone
+{
+  public:
+  static const uint8_t INPUTS = 16;  ///< the number of switches
+
+  /**
+   * Gesture enumerated type.
+   */
+  enum gesture_t : uint8_t
+  {
+    G_NONE,           ///< no gesture
+    G_CLICK,          ///< single click
+    G_DOUBLE_CLICK,   ///< double click
+    G_LONG_PRESS,     ///< long press time reached, switch still held
+    G_HOLD_RELEASE,   ///< switch released after a long press
+  };
+
+  /**
+   * Initialize the classifier.
+   */
+  inline void begin(void) {}
+
+  /**
+   * Set the gesture times, which are ignored.
+   *
+   * \param doubleClick the time allowed between a release and the next press for a double click.
+   * \param longPress   the time a switch must be held for a long press.
+   */
+  inline void setTimes(uint16_t doubleClick, uint16_t longPress) { (void)doubleClick; (void)longPress; }
+
+  /**
+   * Check if the classifier is enabled.
+   *
+   * \return false as the classifier is never enabled.
+   */
+  inline bool isEnabled(void) const { return(false); }
+
+  /**
+   * Check if any switch is being classified.
+   *
+   * \return false as no switch is classified.
+   */
+  inline bool isActive(void) const { return(false); }
+
+  /**
+   * Update the classifier for one switch.
+   *
+   * \param i        the switch number.
+   * \param held     true if the switch is held.
+   * \param now      the current time in milliseconds.
+   * \param duration the variable to receive the hold time for G_HOLD_RELEASE.
+   * \return G_NONE as no gesture is detected.
+   */
+  inline gesture_t update(uint8_t i, bool held, uint16_t now, uint16_t &duration)
+  {
+    (void)i; (void)held; (void)now; (void)duration;
+    return(G_NONE);
+  }
+};
@@ -0,0 +1,360 @@
+/*
+MD_Gamepad - Library to encapsulate a Gamepad/Joystick Shield.
+
+See main header file for information.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * \file
+ * \brief Host (non-Arduino) hardware abstraction for the MD_Gamepad library
+ *
+ * This file is included by MD_Gamepad.h in place of Arduino.h when the library is
+ * not compiled by the Arduino build system (ARDUINO is not defined). It provides
+ * the subset of the Arduino API used by the library, backed by a simulated
+ * hardware model in MD_GamepadHAL:
+ * - digital pin levels, read by digitalRead() and the mock PIND/PINB/PINC registers.
+ * - ADC values for each analog channel, read by analogRead() and the mock ADC registers.
+ * - a clock that only advances when the application says so.
+ * - counters of every call made to the hardware, and a model of what these calls
+ *   would cost in processor cycles on the target.
+ *
+ * This allows the library to be compiled and exercised on a Linux host, and the
+ * counters show how many hardware accesses each method makes.
+ */
+
+// Arduino API constants
+#define LOW   0       ///< Digital pin level low
+#define HIGH  1       ///< Digital pin level high
+#define INPUT 0       ///< Pin mode input
+#define OUTPUT 1      ///< Pin mode output
+#define INPUT_PULLUP 2  ///< Pin mode input with pullup
+
+static const uint8_t A0 = 14;   ///< Analog pin 0 (Uno numbering)
+static const uint8_t A1 = 15;   ///< Analog pin 1
+static const uint8_t A2 = 16;   ///< Analog pin 2
+static const uint8_t A3 = 17;   ///< Analog pin 3
+static const uint8_t A4 = 18;   ///< Analog pin 4
+static const uint8_t A5 = 19;   ///< Analog pin 5
+static const uint8_t A6 = 20;   ///< Analog pin 6, analog only with no port bit
+static const uint8_t A7 = 21;   ///< Analog pin 7, analog only with no port bit
+
+#define _BV(b) (1 << (b))       ///< AVR bit value macro
+
+// Program memory tables are ordinary constant data on the host
+#define PROGMEM                 ///< AVR program memory attribute
+#define pgm_read_word(p) (*(const uint16_t *)(p))   ///< Read a word from program memory
+
+// Simulated pin change interrupt registers, used when GAMEPAD_PCINT is set to 1.
+// The interrupt handlers are called by MD_GamepadHAL::setSwitch() when enabled.
+#define PCIE0 0   ///< PCICR pin change interrupt enable 0 (D8-D13)
+#define PCIE2 2   ///< PCICR pin change interrupt enable 2 (D0-D7)
+
+/**
+ * Simulated pin change interrupt registers.
+ */
+struct MD_GamepadHAL_PCINT
+{
+  static uint8_t pcicr;    ///< PCICR register
+  static uint8_t pcmsk0;   ///< PCMSK0 register
+  static uint8_t pcmsk2;   ///< PCMSK2 register
+};
+
+uint8_t MD_GamepadHAL_PCINT::pcicr;
+uint8_t MD_GamepadHAL_PCINT::pcmsk0;
+uint8_t MD_GamepadHAL_PCINT::pcmsk2;
+
+#define PCICR  (MD_GamepadHAL_PCINT::pcicr)    ///< Simulated pin change interrupt control register
+#define PCMSK0 (MD_GamepadHAL_PCINT::pcmsk0)   ///< Simulated pin change mask register 0
+#define PCMSK2 (MD_GamepadHAL_PCINT::pcmsk2)   ///< Simulated pin change mask register 2
+
+// Pin change interrupt handlers, weak so they are null unless defined by the library
+void PCINT0_vect(void) __attribute__((weak));
+void PCINT2_vect(void) __attribute__((weak));
+
+/**
+ * Simulated hardware for the host build.
+ *
+ * All the members are static as there is only one set of hardware. The
+ * application (or test code) sets the pin levels, ADC values and the time
+ * and then calls the library methods.
+ */
+struct MD_GamepadHAL
+{
+  static const uint8_t PIN_COUNT = 22;   ///< Number of pins simulated (Uno layout, with the Nano A6-A7)
+  static const uint8_t ADC_COUNT = 8;    ///< Number of analog channels simulated
+
+  /**
+   * Counters for the hardware accesses.
+   */
+  struct count_t
+  {
+    uint32_t millis;       ///< calls to millis()
+    uint32_t micros;       ///< calls to micros()
+    uint32_t pinMode;      ///< calls to pinMode()
+    uint32_t digitalRead;  ///< calls to digitalRead()
+    uint32_t analogRead;   ///< calls to analogRead()
+    uint32_t portRead;     ///< reads of the PIND/PINB registers
+    uint32_t adcRead;      ///< reads of the ADC result register
+    uint32_t isr;          ///< interrupt handlers called
+    uint64_t cycles;       ///< modeled target processor cycles for all the accesses
+  };
+
+  /**
+   * Modeled cost in target processor cycles of each hardware access.
+   *
+   * The defaults are typical for the Arduino core on a 16MHz ATmega328P.
+   */
+  struct cost_t
+  {
+    uint16_t millis;       ///< cycles for millis()
+    uint16_t micros;       ///< cycles for micros()
+    uint16_t pinMode;      ///< cycles for pinMode()
+    uint16_t digitalRead;  ///< cycles for digitalRead()
+    uint16_t analogRead;   ///< cycles for analogRead(), including the conversion
+    uint16_t portRead;     ///< cycles for a port register read
+    uint16_t adcRead;      ///< cycles for an ADC result register read
+    uint16_t isr;          ///< cycles for an interrupt entry and exit, including the register saves
+  };
+
+  static uint8_t  pinLevel[PIN_COUNT];   ///< the level of each digital pin
+  static uint8_t  pinModes[PIN_COUNT];   ///< the last mode set for each pin
+  static uint16_t adcValue[ADC_COUNT];   ///< the value converted for each analog channel
+  static uint32_t timeMicros;            ///< the simulated time in microseconds
+  static count_t  count;                 ///< the hardware access counters
+  static cost_t   cost;                  ///< the modeled cost of each access
+  static uint32_t clockHz;               ///< the modeled target clock frequency
+
+  /**
+   * Reset the simulated hardware.
+   *
+   * All the pins are set HIGH (switches open), ADC values to mid range,
+   * the time to 0 and the counters cleared.
+   */
+  static void reset(void)
+  {
+    for (uint8_t i = 0; i < PIN_COUNT; i++)
+    {
+      pinLevel[i] = HIGH;
+      pinModes[i] = INPUT;
+    }
+    for (uint8_t i = 0; i < ADC_COUNT; i++)
+      adcValue[i] = 512;
+    timeMicros = 0;
+    PCICR = PCMSK0 = PCMSK2 = 0;
+    clearCount();
+  }
+
+  /**
+   * Clear the hardware access counters.
+   */
+  static void clearCount(void) { count = count_t(); }
+
+  /**
+   * Advance the simulated time.
+   *
+   * \param ms the number of milliseconds to advance.
+   */
+  static void advance(uint32_t ms) { timeMicros += ms * 1000; }
+
+  /**
+   * Set the level of a switch pin.
+   *
+   * The switches are active low, so a pressed switch reads LOW. If the level 
+   * changes and the pin change interrupt for the pin is enabled, the interrupt 
+   * handler is called as it would be on the target.
+   *
+   * \param pin     the digital pin number.
+   * \param pressed true if the switch is pressed.
+   */
+  static void setSwitch(uint8_t pin, bool pressed) 
+  { 
+    uint8_t level = (pressed ? LOW : HIGH);
+
+    if (pinLevel[pin] == level)
+      return;
+    pinLevel[pin] = level;
+
+    if (pin < 8)
+    {
+      if ((PCICR & _BV(PCIE2)) && (PCMSK2 & _BV(pin)) && PCINT2_vect != nullptr)
+        interrupt(PCINT2_vect);
+    }
+    else if (pin < 14)
+    {
+      if ((PCICR & _BV(PCIE0)) && (PCMSK0 & _BV(pin - 8)) && PCINT0_vect != nullptr)
+        interrupt(PCINT0_vect);
+    }
+  }
+
+  /**
+   * Call an interrupt handler, counting the interrupt.
+   *
+   * \param isr the interrupt handler.
+   */
+  static void interrupt(void (*isr)(void))
+  {
+    count.isr++;
+    count.cycles += cost.isr;
+    isr();
+  }
+
+  /**
+   * Set the ADC value for an analog pin.
+   *
+   * \param pin   the analog pin number (A0 to A5) or channel number.
+   * \param value the value returned by conversions of this pin.
+   */
+  static void setAnalog(uint8_t pin, uint16_t value) { adcValue[channel(pin)] = value; }
+
+  /**
+   * Convert an analog pin number to the ADC channel.
+   *
+   * \param pin the analog pin number (A0 to A5) or channel number.
+   * \return the ADC channel.
+   */
+  static uint8_t channel(uint8_t pin) { return((pin >= A0 ? pin - A0 : pin) % ADC_COUNT); }
+
+  /**
+   * Read a simulated port input register.
+   *
+   * Port D holds pins D0-D7, port B holds pins D8-D13 in bits 0-5 and port C
+   * holds pins A0-A5 in bits 0-5 (Uno layout).
+   *
+   * \param port 'B', 'C' or 'D'.
+   * \return the register value.
+   */
+  static uint8_t readPort(char port)
+  {
+    uint8_t first = (port == 'D' ? 0 : port == 'B' ? 8 : A0);
+    uint8_t last = (port == 'D' ? 8 : port == 'B' ? 14 : A6);
+    uint8_t v = 0;
+
+    count.portRead++;
+    count.cycles += cost.portRead;
+    for (uint8_t i = first; i < last; i++)
+      if (pinLevel[i] != LOW)
+        v |= _BV(i - first);
+
+    return(v);
+  }
+};
+
+uint8_t  MD_GamepadHAL::pinLevel[MD_GamepadHAL::PIN_COUNT];
+uint8_t  MD_GamepadHAL::pinModes[MD_GamepadHAL::PIN_COUNT];
+uint16_t MD_GamepadHAL::adcValue[MD_GamepadHAL::ADC_COUNT];
+uint32_t MD_GamepadHAL::timeMicros;
+MD_GamepadHAL::count_t MD_GamepadHAL::count;
+MD_GamepadHAL::cost_t  MD_GamepadHAL::cost = { 28, 44, 72, 58, 1760, 1, 2, 70 };
+uint32_t MD_GamepadHAL::clockHz = 16000000UL;
+
+// Arduino API functions on the simulated hardware
+inline uint32_t millis(void)
+{
+  MD_GamepadHAL::count.millis++;
+  MD_GamepadHAL::count.cycles += MD_GamepadHAL::cost.millis;
+  return(MD_GamepadHAL::timeMicros / 1000);
+}
+
+inline uint32_t micros(void)
+{
+  MD_GamepadHAL::count.micros++;
+  MD_GamepadHAL::count.cycles += MD_GamepadHAL::cost.micros;
+  return(MD_GamepadHAL::timeMicros);
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode)
+{
+  MD_GamepadHAL::count.pinMode++;
+  MD_GamepadHAL::count.cycles += MD_GamepadHAL::cost.pinMode;
+  MD_GamepadHAL::pinModes[pin % MD_GamepadHAL::PIN_COUNT] = mode;
+}
+
+inline int digitalRead(uint8_t pin)
+{
+  MD_GamepadHAL::count.digitalRead++;
+  MD_GamepadHAL::count.cycles += MD_GamepadHAL::cost.digitalRead;
+  return(MD_GamepadHAL::pinLevel[pin % MD_GamepadHAL::PIN_COUNT]);
+}
+
+inline int analogRead(uint8_t pin)
+{
+  MD_GamepadHAL::count.analogRead++;
+  MD_GamepadHAL::count.cycles += MD_GamepadHAL::cost.analogRead;
+  return(MD_GamepadHAL::adcValue[MD_GamepadHAL::channel(pin)]);
+}
+
+// Simulated port input registers, used when GAMEPAD_PORT_IO is set to 1
+#define PIND (MD_GamepadHAL::readPort('D'))   ///< Simulated port D input register
+#define PINB (MD_GamepadHAL::readPort('B'))   ///< Simulated port B input register
+#define PINC (MD_GamepadHAL::readPort('C'))   ///< Simulated port C input register
+
+// Simulated ADC registers, used when GAMEPAD_ADC_ISR is set to 1.
+// A conversion is completed by calling MD_GamepadHAL_ADC::convert().
+#define ADEN  7   ///< ADCSRA ADC enable bit
+#define ADSC  6   ///< ADCSRA start conversion bit
+#define ADIE  3   ///< ADCSRA interrupt enable bit
+#define ADPS2 2   ///< ADCSRA prescaler bit 2
+#define ADPS1 1   ///< ADCSRA prescaler bit 1
+#define ADPS0 0   ///< ADCSRA prescaler bit 0
+#define REFS0 6   ///< ADMUX reference selection bit 0
+
+#define ISR(v) void v(void)   ///< Interrupt handlers are plain functions on the host
+
+/**
+ * Simulated ADC peripheral registers.
+ */
+struct MD_GamepadHAL_ADC
+{
+  static uint8_t admux;    ///< ADMUX register
+  static uint8_t adcsra;   ///< ADCSRA register
+
+  /**
+   * Read the ADC result register.
+   *
+   * \return the result of the last conversion.
+   */
+  static uint16_t result(void) 
+  { 
+    MD_GamepadHAL::count.adcRead++; 
+    MD_GamepadHAL::count.cycles += MD_GamepadHAL::cost.adcRead;
+    return(_result); 
+  }
+
+  /**
+   * Complete the conversion in progress.
+   *
+   * If a conversion was started (ADSC set), the value for the channel selected
+   * in ADMUX is latched into the result register, ADSC is cleared and, if
+   * enabled, the conversion complete interrupt handler is called.
+   *
+   * \param isr the ADC_vect interrupt handler.
+   * \return true if a conversion was completed.
+   */
+  static bool convert(void (*isr)(void))
+  {
+    if (!(adcsra & _BV(ADSC)))
+      return(false);
+
+    _result = MD_GamepadHAL::adcValue[admux & 0x07];
+    adcsra &= ~_BV(ADSC);
+    if ((adcsra & _BV(ADIE)) && isr != nullptr)
+      MD_GamepadHAL::interrupt(isr);
+
+    return(true);
+  }
+
+  static uint16_t _result;  ///< the latched conversion result
+};
+
+uint8_t  MD_GamepadHAL_ADC::admux;
+uint8_t  MD_GamepadHAL_ADC::adcsra;
+uint16_t MD_GamepadHAL_ADC::_result;
+
+#define ADMUX  (MD_GamepadHAL_ADC::admux)     ///< Simulated ADC multiplexer register
+#define ADCSRA (MD_GamepadHAL_ADC::adcsra)    ///< Simulated ADC control and status register
+#define ADC    (MD_GamepadHAL_ADC::result())  ///< Simulated ADC result register
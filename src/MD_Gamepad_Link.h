@@ -0,0 +1,645 @@
+/*
+MD_Gamepad - Library to encapsulate a Gamepad/Joystick Shield.
+
+See main header file for information.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "MD_Gamepad_Stream.h"
+#include "MD_Gamepad_Queue.h"
+
+/**
+ * \file
+ * \brief Radio link layer for the MD_Gamepad library
+ *
+ * Sends the gamepad state over a packet radio such as the nRF24L01 fitted to the
+ * shield. The state changes are recorded as timestamped delta records, with the
+ * same fields and flags as the MD_GamepadStream frames, and several records are
+ * packed into each payload of up to PAYLOAD_MAX bytes:
+ * | Bytes | Field | Notes |
+ * |-------|-------|-------|
+ * | 1 | seq   | sequence number of the first record, incremented for every record |
+ * | 2 | time  | time of the first record, low 16 bits of millis() |
+ * | n | records | one or more records |
+ *
+ * Each record is, in little endian byte order:
+ * | Bytes | Field | Notes |
+ * |-------|-------|-------|
+ * | 1 | flags | F_SW, F_X, F_Y for the fields present, F_FULL for a full record, and the span in the top 4 bits |
+ * | 1 | dt    | time after the first record in milliseconds |
+ * | 2 | sw    | switch bitmap, if F_SW is set |
+ * | 2 | x     | X axis value, if F_X is set |
+ * | 2 | y     | Y axis value, if F_Y is set |
+ *
+ * A record can stand for several records in a row merged into one with the state 
+ * after the last of them. The span is the number of records merged into it after 
+ * the first, so the record uses the sequence numbers seq to seq + span and the 
+ * next record starts at seq + span + 1. The time and fields are those of the 
+ * last record merged, with the flags of all the records merged.
+ *
+ * Payloads are sent without retransmits, so a lost payload never delays the ones
+ * after it. Instead, each payload repeats the records from the previous payloads 
+ * (the redundancy), each merged into one record, so the state is only lost if 
+ * that many payloads in a row are lost. The new records are sent one by one if 
+ * they fit with the repeated records, and are otherwise merged too. The receiver 
+ * discards the records it has already seen, and if records are lost it asks for 
+ * a full record in the ACK payload.
+ *
+ * The ACK payload also carries the link configuration set by the receiver, so
+ * the receiver can change the redundancy, keepalive and packet interval of the
+ * transmitter:
+ * | Bytes | Field | Notes |
+ * |-------|-------|-------|
+ * | 1 | flags | ACK_RESYNC to ask for a full record |
+ * | 1 | version | configuration version, 0 for no configuration |
+ * | 1 | redundancy | number of previous payloads repeated |
+ * | 2 | keepalive | longest time between full records |
+ * | 2 | interval | minimum time between payloads |
+ *
+ * The radio is accessed through a transport class passed as a template parameter,
+ * so the link can be built and tested on a host against a simulated radio. The
+ * transport class must provide the methods below. With the RF24 library, set
+ * `radio.setRetries(0, 0)`, `radio.enableDynamicPayloads()` and
+ * `radio.enableAckPayload()`, then:
+ * \code
+ * struct RF24Transport
+ * {
+ *   RF24 &radio;
+ *
+ *   // Transmitter: send a payload once, true if it was acknowledged
+ *   bool send(const uint8_t *buf, uint8_t len) { return(radio.write(buf, len)); }
+ *
+ *   // Transmitter: read the ACK payload of the last payload sent, return its length or 0
+ *   uint8_t readAck(uint8_t *buf)
+ *   {
+ *     if (!radio.isAckPayloadAvailable()) return(0);
+ *     uint8_t len = radio.getDynamicPayloadSize();
+ *     radio.read(buf, len);
+ *     return(len);
+ *   }
+ *
+ *   // Receiver: read a received payload, return its length or 0
+ *   uint8_t receive(uint8_t *buf)
+ *   {
+ *     if (!radio.available()) return(0);
+ *     uint8_t len = radio.getDynamicPayloadSize();
+ *     radio.read(buf, len);
+ *     return(len);
+ *   }
+ *
+ *   // Receiver: load the ACK payload for the next payload received
+ *   void writeAck(const uint8_t *buf, uint8_t len) { radio.writeAckPayload(1, buf, len); }
+ * };
+ * \endcode
+ */
+
+#ifndef LINK_REDUNDANCY_MAX
+#define LINK_REDUNDANCY_MAX  3   ///< Maximum number of previous payloads repeated in each payload
+#endif
+
+/**
+ * Definitions common to the link transmitter and receiver.
+ */
+struct MD_GamepadLink
+{
+  static const uint8_t PAYLOAD_MAX = 32;   ///< largest payload, the nRF24L01 limit
+  static const uint8_t HEADER = 3;         ///< payload header size
+  static const uint8_t RECORD_MAX = 8;     ///< largest record
+  static const uint8_t ACK_SIZE = 7;       ///< ACK payload size
+  static const uint8_t ACK_RESYNC = 0x01;  ///< ACK flag asking for a full record
+  static const uint8_t SPAN_SHIFT = 4;     ///< position of the span in the record flags
+
+  /**
+   * Link configuration, set by the receiver and sent in the ACK payload.
+   */
+  struct config_t
+  {
+    uint8_t  version;     ///< configuration version, changed for each new configuration
+    uint8_t  redundancy;  ///< number of previous payloads repeated, up to LINK_REDUNDANCY_MAX
+    uint16_t keepalive;   ///< longest time in milliseconds between full records, 0 for none
+    uint16_t interval;    ///< minimum time in milliseconds between payloads
+  };
+
+  /**
+   * Get the size of a record.
+   *
+   * \param flags the record flags.
+   * \return the number of bytes in the record.
+   */
+  static inline uint8_t recordSize(uint8_t flags)
+  {
+    return(2 + ((flags & MD_GamepadStream::F_SW) ? 2 : 0) +
+      ((flags & MD_GamepadStream::F_X) ? 2 : 0) + ((flags & MD_GamepadStream::F_Y) ? 2 : 0));
+  }
+
+  /**
+   * Get the span of a record.
+   *
+   * \param flags the record flags.
+   * \return the number of records merged into the record after the first.
+   */
+  static inline uint8_t recordSpan(uint8_t flags) { return(flags >> SPAN_SHIFT); }
+
+  /**
+   * A record as queued by the receiver, with the full state after it.
+   */
+  struct record_t : public MD_GamepadStream::frame_t
+  {
+    /**
+     * Merge a later record into this one, keeping the latest state.
+     *
+     * \param r the later record.
+     */
+    void coalesce(const record_t &r) { uint8_t f = flags; *this = r; flags |= f; }
+  };
+
+  // Little endian 16 bit field access
+  static inline void put16(uint8_t *p, uint16_t v) { p[0] = v & 0xff; p[1] = v >> 8; }
+  static inline uint16_t get16(const uint8_t *p) { return(p[0] | (p[1] << 8)); }
+};
+
+/**
+ * Link transmitter.
+ *
+ * add() records the state changes at the gamepad update rate and send() packs
+ * them into a payload at most once every configured interval. The records not 
+ * yet sent are held in a ring of RING entries. If they would not fit in one 
+ * payload, because send() was not called often enough, they are merged into one 
+ * record with the latest state. The new records in each of the last payloads 
+ * are kept merged into one record for the redundant copies.
+ *
+ * \tparam Transport the radio transport class.
+ */
+template <class Transport>
+class MD_GamepadLinkTx : public MD_GamepadLink
+{
+  public:
+  static const uint8_t RING = 8;    ///< number of records not yet sent held, more than fit in a payload
+
+  static_assert(RING > (PAYLOAD_MAX - HEADER) / 4 && RING <= (1 << (8 - SPAN_SHIFT)), "RING must hold a payload of records");
+
+  /**
+   * Create the transmitter.
+   *
+   * \param t the radio transport.
+   */
+  MD_GamepadLinkTx(Transport &t) : _t(t) {}
+
+  /**
+   * Initialize the transmitter.
+   *
+   * The first record is a full record. The configuration can be changed later by
+   * the receiver.
+   *
+   * \param redundancy the number of previous payloads repeated in each payload.
+   * \param keepalive  the longest time in milliseconds between full records, 0 for none.
+   * \param interval   the minimum time in milliseconds between payloads.
+   */
+  void begin(uint8_t redundancy, uint16_t keepalive, uint16_t interval)
+  {
+    _config.version = 0;
+    _config.redundancy = (redundancy > LINK_REDUNDANCY_MAX ? LINK_REDUNDANCY_MAX : redundancy);
+    _config.keepalive = keepalive;
+    _config.interval = interval;
+    _configChanged = false;
+    _full = true;
+    _seq = _unsent = 0;
+    _repeat = 0;
+    _sent = _acked = 0;
+    _lastSend = _lastFull = 0;
+    for (uint8_t i = 0; i < LINK_REDUNDANCY_MAX; i++)
+      _prev[i].flags = 0;
+  }
+
+  /**
+   * Record the state if it has changed or a keepalive is due.
+   *
+   * \param now the current time in milliseconds.
+   * \param sw  the switch bitmap.
+   * \param x   the X axis value.
+   * \param y   the Y axis value.
+   * \return true if a record was added.
+   */
+  bool add(uint16_t now, uint16_t sw, int16_t x, int16_t y)
+  {
+    uint8_t flags = 0;
+
+    if (sw != _last.sw) flags |= MD_GamepadStream::F_SW;
+    if (x != _last.x) flags |= MD_GamepadStream::F_X;
+    if (y != _last.y) flags |= MD_GamepadStream::F_Y;
+    if (_full || (_config.keepalive != 0 && (uint16_t)(now - _lastFull) >= _config.keepalive))
+      flags = MD_GamepadStream::F_FULL | MD_GamepadStream::F_SW | MD_GamepadStream::F_X | MD_GamepadStream::F_Y;
+    if (flags == 0)
+      return(false);
+    if (flags & MD_GamepadStream::F_FULL)
+      _lastFull = now;
+
+    _last.flags = flags;
+    _last.time = now;
+    _last.sw = sw;
+    _last.x = x;
+    _last.y = y;
+    _full = false;
+
+    // merge the unsent records if the new one would not fit in one payload with them
+    uint8_t size = recordSize(flags);
+
+    for (uint8_t s = _unsent; s != _seq; s++)
+      size += recordSize(_ring[s % RING].flags);
+    if (_unsent != _seq && (size > PAYLOAD_MAX - HEADER || (uint16_t)(now - _ring[_unsent % RING].time) > 0xff))
+    {
+      for (uint8_t s = _unsent; s != _seq; s++)
+        _last.flags |= _ring[s % RING].flags;
+      _seq = _unsent;
+    }
+
+    _last.seq = _seq;
+    _ring[_seq++ % RING] = _last;
+
+    return(true);
+  }
+
+  /**
+   * Send a payload if there are records to send and the interval has passed.
+   *
+   * After new records are sent, the next redundancy payloads are sent even if
+   * there are no new records, so the last change is repeated.
+   *
+   * \param now the current time in milliseconds.
+   * \return true if a payload was sent.
+   */
+  bool send(uint16_t now)
+  {
+    uint8_t buf[PAYLOAD_MAX];
+
+    if (_unsent == _seq && _repeat == 0)
+      return(false);
+    if ((uint16_t)(now - _lastSend) < _config.interval && _sent != 0)
+      return(false);
+
+    // the new records merged into one, for the redundant copies
+    MD_GamepadStream::frame_t merged = MD_GamepadStream::frame_t();
+    uint8_t sizeNew = 0, sizeMerged = 0;
+
+    if (_unsent != _seq)
+    {
+      merged = _ring[(_seq - 1) % RING];
+      merged.seq = _unsent;
+      merged.flags = (_seq - _unsent - 1) << SPAN_SHIFT;
+      for (uint8_t s = _unsent; s != _seq; s++)
+      {
+        merged.flags |= _ring[s % RING].flags;
+        sizeNew += recordSize(_ring[s % RING].flags);
+      }
+      sizeMerged = recordSize(merged.flags);
+    }
+
+    // the previous payloads repeated, leaving out the oldest if they do not fit 
+    // with the new records merged
+    uint8_t r = _config.redundancy, size = 0;
+    uint16_t last = merged.time;
+
+    for (uint8_t i = r; i > 0; i--)
+    {
+      if (_prev[i - 1].flags == 0)
+        continue;
+      size += recordSize(_prev[i - 1].flags);
+      if (_unsent == _seq) last = _prev[i - 1].time;
+    }
+    while (r > 0 && (_prev[r - 1].flags == 0 || size + sizeMerged > PAYLOAD_MAX - HEADER ||
+      (uint16_t)(last - _prev[r - 1].time) > 0xff))
+    {
+      if (_prev[--r].flags != 0)
+        size -= recordSize(_prev[r].flags);
+    }
+
+    // the new records are sent one by one if they fit with the repeated records
+    bool single = (size + sizeNew <= PAYLOAD_MAX - HEADER &&
+      (r == 0 || (uint16_t)(last - _prev[r - 1].time) <= 0xff));
+
+    if (r == 0 && _unsent == _seq)
+      return(false);
+
+    // pack the records
+    uint16_t t0 = (r != 0 ? _prev[r - 1].time : _ring[_unsent % RING].time);
+    uint8_t n = HEADER;
+
+    buf[0] = (r != 0 ? _prev[r - 1].seq : _unsent);
+    put16(&buf[1], t0);
+    while (r > 0)
+      if (_prev[--r].flags != 0)
+        n = pack(buf, n, _prev[r], t0);
+    if (single)
+      for (uint8_t s = _unsent; s != _seq; s++)
+        n = pack(buf, n, _ring[s % RING], t0);
+    else if (_unsent != _seq)
+      n = pack(buf, n, merged, t0);
+
+    if (_unsent != _seq)
+      _repeat = _config.redundancy;
+    else if (_repeat != 0)
+      _repeat--;
+    for (uint8_t i = LINK_REDUNDANCY_MAX - 1; i > 0; i--)
+      _prev[i] = _prev[i - 1];
+    _prev[0] = merged;
+    _unsent = _seq;
+    _lastSend = now;
+    _sent++;
+
+    if (_t.send(buf, n))
+    {
+      _acked++;
+      n = _t.readAck(buf);
+      if (n >= ACK_SIZE)
+        applyAck(buf);
+    }
+
+    return(true);
+  }
+
+  /**
+   * Get the link configuration.
+   *
+   * \return the configuration in use.
+   */
+  inline const config_t &getConfig(void) const { return(_config); }
+
+  /**
+   * Check if the receiver has changed the configuration.
+   *
+   * The flag is cleared when it is read.
+   *
+   * \return true if a new configuration was received since the last call.
+   */
+  bool configChanged(void) { bool b = _configChanged; _configChanged = false; return(b); }
+
+  /**
+   * Get the number of payloads sent.
+   *
+   * \return the number of payloads sent.
+   */
+  inline uint32_t sent(void) const { return(_sent); }
+
+  /**
+   * Get the number of payloads acknowledged.
+   *
+   * \return the number of payloads acknowledged.
+   */
+  inline uint32_t acked(void) const { return(_acked); }
+
+  private:
+  Transport &_t;                          ///< the radio transport
+  config_t  _config;                      ///< the link configuration
+  bool      _configChanged;               ///< true when a new configuration has been received
+  bool      _full;                        ///< true to add a full record next
+  MD_GamepadStream::frame_t _last;        ///< the last state recorded
+  MD_GamepadStream::frame_t _ring[RING];  ///< the records not yet sent
+  MD_GamepadStream::frame_t _prev[LINK_REDUNDANCY_MAX];  ///< the new records in each of the last payloads merged, flags 0 for none
+  uint8_t   _seq;                         ///< sequence number of the next record
+  uint8_t   _unsent;                      ///< sequence number of the first record not sent
+  uint8_t   _repeat;                      ///< payloads still to send to repeat the last records
+  uint16_t  _lastSend;                    ///< time the last payload was sent
+  uint16_t  _lastFull;                    ///< time the last full record was added
+  uint32_t  _sent;                        ///< payloads sent
+  uint32_t  _acked;                       ///< payloads acknowledged
+
+  // Pack a record into a payload at n, returning the new length
+  static uint8_t pack(uint8_t *buf, uint8_t n, const MD_GamepadStream::frame_t &f, uint16_t t0)
+  {
+    buf[n++] = f.flags;
+    buf[n++] = f.time - t0;
+    if (f.flags & MD_GamepadStream::F_SW) { put16(&buf[n], f.sw); n += 2; }
+    if (f.flags & MD_GamepadStream::F_X)  { put16(&buf[n], f.x);  n += 2; }
+    if (f.flags & MD_GamepadStream::F_Y)  { put16(&buf[n], f.y);  n += 2; }
+
+    return(n);
+  }
+
+  // Apply an ACK payload
+  void applyAck(const uint8_t *buf)
+  {
+    if (buf[0] & ACK_RESYNC)
+      _full = true;
+    if (buf[1] != 0 && buf[1] != _config.version)
+    {
+      _config.version = buf[1];
+      _config.redundancy = (buf[2] > LINK_REDUNDANCY_MAX ? LINK_REDUNDANCY_MAX : buf[2]);
+      _config.keepalive = get16(&buf[3]);
+      _config.interval = get16(&buf[5]);
+      _configChanged = true;
+    }
+  }
+};
+
+/**
+ * Link receiver.
+ *
+ * receive() reads the payloads from the transport and applies the new records in
+ * order, discarding the repeated copies. A merged record is applied if any of
+ * the records merged into it are new. Each record applied is queued with the
+ * full state after it, and read in order with read(). The receiver is synchronized
+ * after a full record is received, and loses synchronization when records are
+ * lost, until the next full record.
+ *
+ * \tparam Transport the radio transport class.
+ */
+template <class Transport>
+class MD_GamepadLinkRx : public MD_GamepadLink
+{
+  public:
+  /**
+   * Create the receiver.
+   *
+   * \param t the radio transport.
+   */
+  MD_GamepadLinkRx(Transport &t) : _t(t) {}
+
+  /**
+   * Receiver statistics.
+   */
+  struct stats_t
+  {
+    uint32_t packets;     ///< payloads received
+    uint32_t records;     ///< new records applied
+    uint32_t duplicates;  ///< repeated records discarded
+    uint32_t lost;        ///< records never received
+    uint32_t corrupt;     ///< payloads that could not be parsed
+  };
+
+  /**
+   * Initialize the receiver, with no configuration for the transmitter.
+   */
+  void begin(void)
+  {
+    _config.version = 0;
+    _config.redundancy = 0;
+    _config.keepalive = _config.interval = 0;
+    _synced = _started = false;
+    _stats.packets = _stats.records = _stats.duplicates = _stats.lost = _stats.corrupt = 0;
+    _state.seq = _state.flags = 0;
+    _state.time = _state.sw = 0;
+    _state.x = _state.y = 0;
+    _queue.clear();
+    _queue.setOverflow(MD_GamepadQueue<record_t, 16>::DROP_OLDEST);
+    writeAck();
+  }
+
+  /**
+   * Set the configuration sent to the transmitter in the ACK payloads.
+   *
+   * \param redundancy the number of previous payloads repeated in each payload.
+   * \param keepalive  the longest time in milliseconds between full records, 0 for none.
+   * \param interval   the minimum time in milliseconds between payloads.
+   */
+  void setConfig(uint8_t redundancy, uint16_t keepalive, uint16_t interval)
+  {
+    if (++_config.version == 0) _config.version = 1;
+    _config.redundancy = redundancy;
+    _config.keepalive = keepalive;
+    _config.interval = interval;
+    writeAck();
+  }
+
+  /**
+   * Read and apply the payloads received.
+   *
+   * \return the number of new records applied.
+   */
+  uint8_t receive(void)
+  {
+    uint8_t buf[PAYLOAD_MAX];
+    uint8_t len, count = 0;
+
+    while ((len = _t.receive(buf)) != 0)
+    {
+      _stats.packets++;
+      count += apply(buf, len);
+      writeAck();   // each ACK payload is used once
+    }
+
+    return(count);
+  }
+
+  /**
+   * Read the next record from the queue.
+   *
+   * \param f the variable to receive the record, with the full state after it.
+   * \return true if a record was read, false if the queue is empty.
+   */
+  bool read(MD_GamepadStream::frame_t &f)
+  {
+    record_t r;
+
+    if (!_queue.pop(r))
+      return(false);
+    f = r;
+
+    return(true);
+  }
+
+  /**
+   * Get the latest state.
+   *
+   * \return the state after the last record applied.
+   */
+  inline const MD_GamepadStream::frame_t &getState(void) const { return(_state); }
+
+  /**
+   * Check if the state is synchronized with the transmitter.
+   *
+   * \return true if a full record has been received and no records lost since.
+   */
+  inline bool isSynced(void) const { return(_synced); }
+
+  /**
+   * Get the receiver statistics.
+   *
+   * \return the receiver statistics.
+   */
+  inline const stats_t &getStats(void) const { return(_stats); }
+
+  private:
+  Transport &_t;                      ///< the radio transport
+  config_t  _config;                  ///< the configuration for the transmitter
+  bool      _synced;                  ///< true while the state is synchronized
+  bool      _started;                 ///< true after the first record
+  uint8_t   _next;                    ///< sequence number of the next record expected
+  record_t  _state;                   ///< the latest state
+  MD_GamepadQueue<record_t, 16> _queue;  ///< records waiting to be read
+  stats_t   _stats;                   ///< the receiver statistics
+
+  // Load the ACK payload for the next payload received
+  void writeAck(void)
+  {
+    uint8_t buf[ACK_SIZE];
+
+    buf[0] = (_synced ? 0 : ACK_RESYNC);
+    buf[1] = _config.version;
+    buf[2] = _config.redundancy;
+    put16(&buf[3], _config.keepalive);
+    put16(&buf[5], _config.interval);
+    _t.writeAck(buf, ACK_SIZE);
+  }
+
+  // Apply the new records in a payload
+  uint8_t apply(const uint8_t *buf, uint8_t len)
+  {
+    uint8_t seq = buf[0];
+    uint16_t time = get16(&buf[1]);
+    uint8_t n = HEADER, count = 0;
+
+    // check the records fit the payload before using any of them
+    if (len <= HEADER)
+    {
+      _stats.corrupt++;
+      return(0);
+    }
+    while (n < len)
+      n += recordSize(buf[n]);
+    if (n != len)
+    {
+      _stats.corrupt++;
+      return(0);
+    }
+
+    for (n = HEADER; n < len; seq++)
+    {
+      uint8_t flags = buf[n];
+      uint8_t end = seq + recordSpan(flags);
+      int8_t d = seq - _next;
+
+      seq = end;
+      if (_started && (int8_t)(end - _next) < 0)
+      {
+        _stats.duplicates++;
+        n += recordSize(flags);
+        continue;
+      }
+      if (_started && d > 0)
+      {
+        _stats.lost += d;
+        _synced = false;
+      }
+      _started = true;
+      _next = end + 1;
+
+      _state.seq = end;
+      _state.flags = flags & ((1 << SPAN_SHIFT) - 1);
+      _state.time = time + buf[n + 1];
+      n += 2;
+      if (flags & MD_GamepadStream::F_SW) { _state.sw = get16(&buf[n]); n += 2; }
+      if (flags & MD_GamepadStream::F_X)  { _state.x = get16(&buf[n]);  n += 2; }
+      if (flags & MD_GamepadStream::F_Y)  { _state.y = get16(&buf[n]);  n += 2; }
+      if (flags & MD_GamepadStream::F_FULL)
+        _synced = true;
+
+      _queue.push(_state);
+      _stats.records++;
+      count++;
+    }
+
+    return(count);
+  }
+};
@@ -0,0 +1,309 @@
+/*
+MD_Gamepad - Library to encapsulate a Gamepad/Joystick Shield.
+
+See main header file for information.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \file
+ * \brief Lock free event queue for the MD_Gamepad library
+ */
+
+/**
+ * \def GAMEPAD_BARRIER
+ * Compiler memory barrier.
+ *
+ * Stops the compiler moving reads or writes of the queue buffer across the
+ * point where the head or tail index is published to the other side.
+ */
+#define GAMEPAD_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+/**
+ * Fixed capacity single producer, single consumer queue.
+ *
+ * The producer (an interrupt handler or update()) only writes the head index and
+ * the consumer (the main loop) only writes the tail index, so no locks are needed
+ * and interrupts are never disabled. The indices are free running 8 bit counters,
+ * so the queue can be used from an interrupt on 8 bit processors.
+ *
+ * One buffer slot is always kept free, so the queue holds at most N-1 items. When
+ * the queue is full the behavior is set by setOverflow():
+ * - DROP_NEWEST - the new item is discarded.
+ * - DROP_OLDEST - the new item overwrites the oldest item. The consumer detects
+ *   the overrun and skips the overwritten items, provided it runs at least once
+ *   every 256-N items.
+ * - COALESCE - new items are merged into one pending item held by the producer,
+ *   which is queued as soon as there is space. T must provide a method
+ *   `void coalesce(const T &item)` to merge an item into the pending item.
+ *
+ * \tparam T the type of item in the queue.
+ * \tparam N the number of buffer slots, a power of 2 no larger than 128.
+ */
+template <class T, uint8_t N>
+class MD_GamepadQueue
+{
+  static_assert(N >= 2 && N <= 128 && (N & (N - 1)) == 0, "Queue size must be a power of 2 between 2 and 128");
+
+  public:
+  /**
+   * Queue overflow behavior enumerated type.
+   */
+  enum overflow_t
+  {
+    DROP_NEWEST,   ///< discard new items when the queue is full
+    DROP_OLDEST,   ///< overwrite the oldest items when the queue is full
+    COALESCE,      ///< merge new items into one pending item when the queue is full
+  };
+
+  /**
+   * Create an empty queue that drops the newest items when full.
+   */
+  MD_GamepadQueue(void) : _overflow(DROP_NEWEST) { clear(); }
+
+  /**
+   * Empty the queue.
+   *
+   * All the items, any pending coalesced item and the dropped counts are
+   * discarded. This must not be called while the producer or consumer can be 
+   * using the queue, for example from an interrupt.
+   */
+  void clear(void)
+  {
+    _head = _tail = 0;
+    _hasPending = false;
+    _droppedProducer = _droppedConsumer = 0;
+  }
+
+  /**
+   * Set the overflow behavior.
+   *
+   * Set how items are handled when the queue is full. The default is DROP_NEWEST.
+   * This should be set before the queue is used.
+   *
+   * \param o the new overflow behavior.
+   */
+  inline void setOverflow(overflow_t o) { _overflow = o; }
+
+  /**
+   * Add an item to the queue.
+   *
+   * Called by the producer only.
+   *
+   * \param item the item to add.
+   * \return true if the item was queued, false if it was dropped or coalesced.
+   */
+  bool push(const T &item)
+  {
+    if (flush() && !isFull())
+    {
+      write(item);
+      return(true);
+    }
+
+    switch (_overflow)
+    {
+    case DROP_OLDEST:
+      write(item);
+      return(true);
+
+    case COALESCE:
+      _droppedProducer++;
+      if (_hasPending)
+        _pending.coalesce(item);
+      else
+      {
+        _pending = T();
+        _pending.coalesce(item);
+        _hasPending = true;
+      }
+      return(false);
+
+    default:
+      _droppedProducer++;
+      return(false);
+    }
+  }
+
+  /**
+   * Queue the pending coalesced item.
+   *
+   * Called by the producer only. If there is a pending item and space in the
+   * queue, the pending item is queued. The producer should call this regularly
+   * so the pending item is delivered even when no new items arrive.
+   *
+   * \return true if there is no pending item left.
+   */
+  bool flush(void)
+  {
+    if (_hasPending && !isFull())
+    {
+      write(_pending);
+      _hasPending = false;
+    }
+
+    return(!_hasPending);
+  }
+
+  /**
+   * Remove the oldest item from the queue.
+   *
+   * Called by the consumer only.
+   *
+   * \param item the variable to receive the item.
+   * \return true if an item was removed, false if the queue was empty.
+   */
+  bool pop(T &item)
+  {
+    uint8_t t = _tail;
+
+    for (;;)
+    {
+      uint8_t h = _head;
+
+      if (h == t)
+        return(false);
+
+      if ((uint8_t)(h - t) >= N)   // producer has overwritten the oldest items
+      {
+        _droppedConsumer += (uint8_t)(h - t) - (N - 1);
+        t = h - (N - 1);
+      }
+
+      GAMEPAD_BARRIER();
+      item = _buf[t & MASK];
+      GAMEPAD_BARRIER();
+
+      // check that the slot was not overwritten while it was copied
+      if ((uint8_t)(_head - t) < N)
+        break;
+    }
+
+    _tail = t + 1;
+
+    return(true);
+  }
+
+  /**
+   * Get the number of items in the queue.
+   *
+   * \return the number of items waiting to be removed.
+   */
+  uint8_t count(void) const
+  {
+    uint8_t n = _head - _tail;
+
+    return(n >= N ? N - 1 : n);
+  }
+
+  /**
+   * Get the number of items dropped.
+   *
+   * \return the total number of items lost because the queue was full, including
+   * the items merged into a coalesced item.
+   */
+  inline uint16_t dropped(void) const { return(_droppedProducer + _droppedConsumer); }
+
+  private:
+  static const uint8_t MASK = N - 1;   ///< mask for buffer slot index
+
+  T _buf[N];                 ///< the queue buffer
+  volatile uint8_t _head;    ///< next slot to write, written by producer only
+  volatile uint8_t _tail;    ///< next slot to read, written by consumer only
+  overflow_t _overflow;      ///< behavior when the queue is full
+
+  // Producer only data
+  T _pending;                ///< items coalesced while the queue is full
+  bool _hasPending;          ///< true if _pending holds an item
+  volatile uint16_t _droppedProducer;  ///< items dropped or coalesced when the queue was full
+
+  // Consumer only data
+  uint16_t _droppedConsumer; ///< items skipped after being overwritten
+
+  // Check if the queue is full (producer)
+  inline bool isFull(void) const { return((uint8_t)(_head - _tail) >= N - 1); }
+
+  // Write an item at the head of the queue and publish it (producer)
+  void write(const T &item)
+  {
+    uint8_t h = _head;
+
+    _buf[h & MASK] = item;
+    GAMEPAD_BARRIER();
+    _head = h + 1;
+  }
+};
+
+/**
+ * No queue.
+ *
+ * The same interface as MD_GamepadQueue with no buffer. Every item is discarded
+ * and the queue is always empty. Discarded items are not counted as dropped.
+ */
+class MD_GamepadQueueNone
+{
+  public:
+  /**
+   * Queue overflow behavior enumerated type.
+   */
+  enum overflow_t
+  {
+    DROP_NEWEST,   ///< discard new items when the queue is full
+    DROP_OLDEST,   ///< overwrite the oldest items when the queue is full
+    COALESCE,      ///< merge new items into one pending item when the queue is full
+  };
+
+  /**
+   * Empty the queue.
+   */
+  inline void clear(void) {}
+
+  /**
+   * Set the overflow behavior, which is ignored.
+   *
+   * \param o the new overflow behavior.
+   */
+  inline void setOverflow(overflow_t o) { (void)o; }
+
+  /**
+   * Discard an item.
+   *
+   * \param item the item to add.
+   * \return false as the item is never queued.
+   */
+  template <class T>
+  inline bool push(const T &item) { (void)item; return(false); }
+
+  /**
+   * Queue the pending coalesced item.
+   *
+   * \return true as there is never a pending item.
+   */
+  inline bool flush(void) { return(true); }
+
+  /**
+   * Remove the oldest item from the queue.
+   *
+   * \param item the variable to receive the item.
+   * \return false as the queue is always empty.
+   */
+  template <class T>
+  inline bool pop(T &item) { (void)item; return(false); }
+
+  /**
+   * Get the number of items in the queue.
+   *
+   * \return 0 as the queue is always empty.
+   */
+  inline uint8_t count(void) const { return(0); }
+
+  /**
+   * Get the number of items dropped.
+   *
+   * \return 0 as discarded items are not counted.
+   */
+  inline uint16_t dropped(void) const { return(0); }
+};
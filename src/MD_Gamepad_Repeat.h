@@ -0,0 +1,212 @@
+/*
+MD_Gamepad - Library to encapsulate a Gamepad/Joystick Shield.
+
+See main header file for information.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \file
+ * \brief Typematic auto repeat for the MD_Gamepad library
+ *
+ * The auto repeat engine used by MD_GamepadT is selected by the Repeat type in
+ * the configuration (see MD_GamepadShield). The default MD_GamepadRepeatNone has
+ * no settings, so auto repeat costs no RAM unless the configuration selects
+ * MD_GamepadRepeat.
+ */
+
+/**
+ * Typematic auto repeat engine.
+ *
+ * Tracks up to 16 inputs given as a bitmap of the inputs held. Each input fires
+ * once when it is first held, again after its initial delay and then repeatedly
+ * at its repeat interval for as long as it is held. The interval can shrink with
+ * each repeat (acceleration) down to a minimum interval.
+ *
+ * The engine only works on the bitmap passed to update(), so it does not read the
+ * hardware, and it does nothing while no inputs are held.
+ *
+ * \tparam N the number of inputs, 1 to 16.
+ */
+template <uint8_t N>
+class MD_GamepadRepeat
+{
+  static_assert(N >= 1 && N <= 16, "Repeat inputs must be 1 to 16");
+
+  public:
+  static const uint8_t INPUTS = N;   ///< the number of inputs
+
+  /**
+   * Repeat settings for one input.
+   */
+  struct config_t
+  {
+    uint16_t delay;       ///< time from the first fire to the first repeat in milliseconds
+    uint16_t interval;    ///< initial time between repeats in milliseconds, 0 for no repeat
+    uint16_t minInterval; ///< shortest time between repeats with acceleration
+    uint8_t  accel;       ///< interval reduction at each repeat, in 1/256 of the interval
+  };
+
+  /**
+   * Initialize the engine with repeat disabled for all inputs.
+   */
+  void begin(void)
+  {
+    _held = _fired = _repeated = 0;
+    for (uint8_t i = 0; i < N; i++)
+      set(i, 0, 0, 0, 0);
+  }
+
+  /**
+   * Set the repeat settings for an input.
+   *
+   * \param i           the input number, 0 to N-1.
+   * \param delay       the time from the first fire to the first repeat in milliseconds.
+   * \param interval    the initial time between repeats in milliseconds, 0 for no repeat.
+   * \param minInterval the shortest time between repeats, 0 or greater than interval for no acceleration.
+   * \param accel       the interval reduction at each repeat, in 1/256 of the interval.
+   */
+  void set(uint8_t i, uint16_t delay, uint16_t interval, uint16_t minInterval, uint8_t accel)
+  {
+    if (i >= N) return;
+
+    _config[i].delay = delay;
+    _config[i].interval = interval;
+    _config[i].minInterval = (minInterval == 0 || minInterval > interval ? interval : minInterval);
+    _config[i].accel = accel;
+  }
+
+  /**
+   * Update the engine.
+   *
+   * \param held bitmap of the inputs held, bit i for input i.
+   * \param now  the current time in milliseconds.
+   * \return bitmap of the inputs that fired, either first held or repeated.
+   */
+  uint16_t update(uint16_t held, uint16_t now)
+  {
+    uint16_t pressed = held & ~_held;
+
+    _held = held;
+    _fired = pressed;
+    _repeated = 0;
+
+    for (uint8_t i = 0; held != 0; i++, held >>= 1)
+    {
+      if (!(held & 1))
+        continue;
+
+      const config_t &c = _config[i];
+
+      if (pressed & (1 << i))
+      {
+        _next[i] = now + c.delay;
+        _interval[i] = c.interval;
+      }
+      else if (_interval[i] != 0 && (int16_t)(now - _next[i]) >= 0)
+      {
+        _repeated |= (1 << i);
+        _next[i] = now + _interval[i];
+        if (_interval[i] > c.minInterval)
+        {
+          uint16_t dec = ((uint32_t)_interval[i] * c.accel) >> 8;
+
+          _interval[i] = (_interval[i] - dec < c.minInterval ? c.minInterval : _interval[i] - dec);
+        }
+      }
+    }
+    _fired |= _repeated;
+
+    return(_fired);
+  }
+
+  /**
+   * Get the inputs that fired in the last update.
+   *
+   * \return bitmap of the inputs first held or repeated.
+   */
+  inline uint16_t fired(void) const { return(_fired); }
+
+  /**
+   * Get the inputs that repeated in the last update.
+   *
+   * \return bitmap of the inputs repeated, not including the inputs first held.
+   */
+  inline uint16_t repeated(void) const { return(_repeated); }
+
+  private:
+  config_t _config[N];     ///< the settings for each input
+  uint16_t _next[N];       ///< the time of the next repeat for each input
+  uint16_t _interval[N];   ///< the current repeat interval for each input
+  uint16_t _held;          ///< bitmap of the inputs held in the last update
+  uint16_t _fired;         ///< bitmap of the inputs fired in the last update
+  uint16_t _repeated;      ///< bitmap of the inputs repeated in the last update
+};
+
+/**
+ * No auto repeat.
+ *
+ * The same interface as MD_GamepadRepeat with no settings. The inputs fire once 
+ * when they are first held and never repeat.
+ */
+class MD_GamepadRepeatNone
+{
+  public:
+  static const uint8_t INPUTS = 16;  ///< the number of inputs
+
+  /**
+   * Initialize the engine.
+   */
+  inline void begin(void) { _held = _fired = 0; }
+
+  /**
+   * Set the repeat settings for an input, which are ignored.
+   *
+   * \param i           the input number.
+   * \param delay       the time from the first fire to the first repeat in milliseconds.
+   * \param interval    the initial time between repeats in milliseconds.
+   * \param minInterval the shortest time between repeats.
+   * \param accel       the interval reduction at each repeat.
+   */
+  inline void set(uint8_t i, uint16_t delay, uint16_t interval, uint16_t minInterval, uint8_t accel)
+  {
+    (void)i; (void)delay; (void)interval; (void)minInterval; (void)accel;
+  }
+
+  /**
+   * Update the engine.
+   *
+   * \param held bitmap of the inputs held, bit i for input i.
+   * \param now  the current time in milliseconds.
+   * \return bitmap of the inputs first held.
+   */
+  inline uint16_t update(uint16_t held, uint16_t now)
+  {
+    (void)now;
+    _fired = held & ~_held;
+    _held = held;
+
+    return(_fired);
+  }
+
+  /**
+   * Get the inputs that fired in the last update.
+   *
+   * \return bitmap of the inputs first held.
+   */
+  inline uint16_t fired(void) const { return(_fired); }
+
+  /**
+   * Get the inputs that repeated in the last update.
+   *
+   * \return 0 as inputs never repeat.
+   */
+  inline uint16_t repeated(void) const { return(0); }
+
+  private:
+  uint16_t _held;          ///< bitmap of the inputs held in the last update
+  uint16_t _fired;         ///< bitmap of the inputs fired in the last update
+};
@@ -0,0 +1,377 @@
+/*
+MD_Gamepad - Library to encapsulate a Gamepad/Joystick Shield.
+
+See main header file for information.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \file
+ * \brief Two dimensional joystick conditioning for the MD_Gamepad library
+ *
+ * A deadband applied to each axis separately is a square around the center, so
+ * small diagonal movements snap to the nearest axis. The stick stage in this file
+ * conditions the X and Y values together as a vector, working on its length
+ * (the radius) so the direction of the joystick is always preserved:
+ * - radial deadzone - lengths up to the inner radius are reported as 0.
+ * - anti-deadzone - the output jumps to this radius as soon as the stick leaves
+ *   the deadzone, to cancel out a deadzone applied by the application (eg, a game).
+ * - outer saturation - lengths beyond the outer radius are reported as full
+ *   deflection, so full output is reached before the mechanical end of travel.
+ * - circle to square - optionally stretches the circular travel of the stick
+ *   onto a square, so the corners (full X and full Y together) can be reached.
+ *
+ * All the arithmetic is integer. The radius is found by an integer square root
+ * and the divisions by the radius are done with a table of reciprocals in program
+ * memory, so each conditioned sample costs a square root, a handful of multiplies
+ * and no division.
+ *
+ * The same methods give the joystick position in polar form: the magnitude and an
+ * angle found by an integer atan2() using a table of arctangents. MD_GamepadSector
+ * quantizes the angle to 4, 8 or 16 directions.
+ *
+ * Angles are binary angle units, where the full circle is 65536 (0x10000) so the
+ * uint16_t angle wraps around naturally. 0 is the positive X axis and the angle
+ * increases towards the positive Y axis, so 0x4000 is 90 degrees.
+ */
+
+/// Reciprocal 2^22/n used to build the reciprocal table, for n = 128 to 256
+constexpr uint16_t stickRecip(uint16_t n) { return((uint16_t)((1UL << 22) / n)); }
+
+#define STICK_RECIP4(n)   stickRecip(n), stickRecip(n+1), stickRecip(n+2), stickRecip(n+3)  ///< 4 table entries
+#define STICK_RECIP16(n)  STICK_RECIP4(n), STICK_RECIP4(n+4), STICK_RECIP4(n+8), STICK_RECIP4(n+12)  ///< 16 table entries
+#define STICK_RECIP64(n)  STICK_RECIP16(n), STICK_RECIP16(n+16), STICK_RECIP16(n+32), STICK_RECIP16(n+48)  ///< 64 table entries
+
+/// Reciprocal table, entry i is 2^22/(128+i) for the top 8 bits of a normalized radius
+static const uint16_t stickRecipTable[129] PROGMEM =
+{
+  STICK_RECIP64(128), STICK_RECIP64(192), stickRecip(256)
+};
+
+#undef STICK_RECIP4
+#undef STICK_RECIP16
+#undef STICK_RECIP64
+
+/// Arctangent table, entry i is atan(i/32) in binary angle units (0x2000 is 45 degrees)
+static const uint16_t stickAtanTable[33] PROGMEM =
+{
+     0,  326,  651,  975, 1297, 1617, 1933, 2246,
+  2555, 2860, 3159, 3453, 3742, 4025, 4302, 4572,
+  4836, 5094, 5344, 5589, 5826, 6058, 6282, 6500,
+  6712, 6917, 7117, 7310, 7498, 7679, 7856, 8026,
+  8192,
+};
+
+/**
+ * Two dimensional stick conditioning stage.
+ *
+ * The radii are set as a percentage of full deflection and converted to axis
+ * units by setRange() whenever the full deflection value changes, so the
+ * conditioning itself only uses precomputed values.
+ */
+class MD_GamepadStick
+{
+  public:
+  /**
+   * Initialize the stage.
+   *
+   * The stage is disabled, with no deadzone, no anti-deadzone, saturation at
+   * full deflection and no circle to square mapping.
+   *
+   * \param full the axis value at full deflection.
+   */
+  void begin(uint16_t full)
+  {
+    _enabled = _square = false;
+    _inner = _anti = 0;
+    _outer = 100;
+    setRange(full);
+  }
+
+  /**
+   * Set the stage radii and enable the stage.
+   *
+   * \param inner the deadzone radius in percent of full deflection.
+   * \param outer the saturation radius in percent of full deflection (inner+1 to 100).
+   * \param anti  the anti-deadzone radius in percent of full deflection.
+   */
+  void set(uint8_t inner, uint8_t outer, uint8_t anti)
+  {
+    _outer = (outer > 100 ? 100 : (outer == 0 ? 1 : outer));
+    _inner = (inner >= _outer ? _outer - 1 : inner);
+    _anti = (anti > 100 ? 100 : anti);
+    _enabled = true;
+    setRange(_full);
+  }
+
+  /**
+   * Enable or disable the stage.
+   *
+   * \param b true to enable the stage.
+   */
+  inline void enable(bool b) { _enabled = b; }
+
+  /**
+   * Check if the stage is enabled.
+   *
+   * \return true if the stage is enabled.
+   */
+  inline bool isEnabled(void) const { return(_enabled); }
+
+  /**
+   * Enable or disable circle to square mapping.
+   *
+   * \param b true to map the circular travel onto a square.
+   */
+  inline void setSquare(bool b) { _square = b; }
+
+  /**
+   * Set the full deflection value and recompute the radii.
+   *
+   * \param full the axis value at full deflection.
+   */
+  void setRange(uint16_t full)
+  {
+    _full = full;
+    _innerV = ((uint32_t)full * _inner) / 100;
+    _outerV = ((uint32_t)full * _outer) / 100;
+    _antiV = ((uint32_t)full * _anti) / 100;
+    if (_outerV <= _innerV) _outerV = _innerV + 1;
+    _k = (((uint32_t)(_full - _antiV) << 16) + (_outerV - _innerV) - 1) / (_outerV - _innerV);  // rounded up
+  }
+
+  /**
+   * Condition a joystick position.
+   *
+   * \param x the X axis value, replaced by the conditioned value.
+   * \param y the Y axis value, replaced by the conditioned value.
+   */
+  void apply(int16_t &x, int16_t &y) const
+  {
+    uint16_t ax = (x < 0 ? -(int32_t)x : x);
+    uint16_t ay = (y < 0 ? -(int32_t)y : y);
+    uint16_t r = isqrt((uint32_t)ax * ax + (uint32_t)ay * ay);
+
+    if (r <= _innerV)
+    {
+      x = y = 0;
+      return;
+    }
+
+    // rescale the radius from inner..outer to anti..full
+    uint16_t rr = (r >= _outerV ? _full : _antiV + (((uint32_t)(r - _innerV) * _k) >> 16));
+
+    // Dividing by the largest component instead of the radius also stretches
+    // the circle onto the square.
+    uint32_t g = gain(rr, _square ? (ax > ay ? ax : ay) : r);
+
+    x = scale(x, ax, g);
+    y = scale(y, ay, g);
+  }
+
+  /**
+   * Integer square root.
+   *
+   * \param v the value.
+   * \return the square root of v, rounded down.
+   */
+  static uint16_t isqrt(uint32_t v)
+  {
+    uint32_t r = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > v) bit >>= 2;
+    while (bit != 0)
+    {
+      if (v >= r + bit)
+      {
+        v -= r + bit;
+        r = (r >> 1) + bit;
+      }
+      else
+        r >>= 1;
+      bit >>= 2;
+    }
+
+    return(r);
+  }
+
+  /**
+   * Integer four quadrant arctangent.
+   *
+   * The angle is reduced to the first octant, where the ratio of the smaller to 
+   * the larger component (0 to 1) is looked up in the arctangent table with linear 
+   * interpolation. The error is less than 0.05 degrees.
+   *
+   * \param y the Y component.
+   * \param x the X component.
+   * \return the angle of (x, y) in binary angle units, 0 if both are 0.
+   */
+  static uint16_t atan2(int16_t y, int16_t x)
+  {
+    uint16_t ax = (x < 0 ? -(int32_t)x : x);
+    uint16_t ay = (y < 0 ? -(int32_t)y : y);
+    bool steep = (ay > ax);
+
+    if (ax == 0 && ay == 0)
+      return(0);
+
+    // ratio in Q16 and table position with 8 fractional bits
+    uint32_t t = (steep ? gain(ax, ay) : gain(ay, ax));
+    uint16_t p = (t > 0x10000 ? 0x10000 : t) >> 3;
+    uint8_t idx = p >> 8;
+    uint16_t a = pgm_read_word(&stickAtanTable[idx]);
+
+    if (idx < 32)
+      a += ((uint32_t)(pgm_read_word(&stickAtanTable[idx + 1]) - a) * (p & 0xff)) >> 8;
+
+    if (steep) a = 0x4000 - a;
+    if (x < 0) a = 0x8000 - a;
+    if (y < 0) a = -a;
+
+    return(a);
+  }
+
+  private:
+  bool     _enabled;  ///< true if the stage is enabled
+  bool     _square;   ///< true for circle to square mapping
+  uint8_t  _inner;    ///< deadzone radius in percent
+  uint8_t  _outer;    ///< saturation radius in percent
+  uint8_t  _anti;     ///< anti-deadzone radius in percent
+  uint16_t _full;     ///< axis value at full deflection
+  uint16_t _innerV;   ///< deadzone radius in axis units
+  uint16_t _outerV;   ///< saturation radius in axis units
+  uint16_t _antiV;    ///< anti-deadzone radius in axis units
+  uint32_t _k;        ///< Q16 radius scale from inner..outer to anti..full
+
+  // Q16 gain n/d for d > 0 using the reciprocal table. d is normalized to
+  // 0x8000..0xffff, the top 8 bits index the table and the low 8 bits
+  // interpolate between entries.
+  static uint32_t gain(uint16_t n, uint16_t d)
+  {
+    uint8_t e = 0;
+
+    while (d < 0x8000) { d <<= 1; e++; }
+
+    const uint16_t *t = &stickRecipTable[(d >> 8) - 128];
+    uint16_t r0 = pgm_read_word(t);
+    uint16_t r = r0 - (((uint32_t)(r0 - pgm_read_word(t + 1)) * (d & 0xff)) >> 8);
+    uint32_t p = (uint32_t)n * r;
+
+    return(e <= 14 ? p >> (14 - e) : p << (e - 14));
+  }
+
+  // Scale one component by the gain, rounded, keeping its sign and saturating at full
+  int16_t scale(int16_t v, uint16_t av, uint32_t g) const
+  {
+    uint32_t s = ((uint32_t)av * g + 0x8000) >> 16;
+
+    if (s > _full) s = _full;
+
+    return(v < 0 ? -(int16_t)s : (int16_t)s);
+  }
+};
+
+/**
+ * Joystick direction quantizer.
+ *
+ * Divides the circle into 4, 8 or 16 equal sectors, with sector 0 centered on the
+ * positive X axis and the sector numbers increasing towards the positive Y axis.
+ * For 8 ways, sector 2 is positive Y, 4 is negative X and 6 is negative Y.
+ *
+ * Each sector is extended by a hysteresis band, so the direction only changes when
+ * the angle moves that far into the next sector and does not chatter when the 
+ * joystick is held on a sector boundary.
+ */
+class MD_GamepadSector
+{
+  public:
+  static const uint8_t CENTER = 0xff;   ///< direction when the joystick is centered
+
+  /**
+   * Initialize the quantizer.
+   *
+   * \param ways       the number of sectors, 4, 8 or 16.
+   * \param hysteresis the hysteresis band in degrees.
+   */
+  void begin(uint8_t ways, uint8_t hysteresis)
+  {
+    _hystDeg = hysteresis;
+    setWays(ways);
+  }
+
+  /**
+   * Set the number of sectors.
+   *
+   * \param ways the number of sectors, 4, 8 or 16. Other values select 8.
+   */
+  void setWays(uint8_t ways)
+  {
+    _shift = (ways == 4 ? 14 : (ways == 16 ? 12 : 13));
+    _sector = CENTER;
+    setHysteresis(_hystDeg);
+  }
+
+  /**
+   * Set the hysteresis band.
+   *
+   * The band is limited to a quarter of the sector width.
+   *
+   * \param degrees the hysteresis band in degrees.
+   */
+  void setHysteresis(uint8_t degrees)
+  {
+    uint16_t h = (uint32_t)degrees * 0x10000 / 360;
+    uint16_t limit = (1 << _shift) / 4;
+
+    _hystDeg = degrees;
+    _hyst = (h > limit ? limit : h);
+  }
+
+  /**
+   * Update the direction from a new joystick position.
+   *
+   * \param angle    the angle in binary angle units.
+   * \param centered true if the joystick is centered.
+   * \return the sector number, or CENTER.
+   */
+  uint8_t update(uint16_t angle, bool centered)
+  {
+    if (centered)
+      _sector = CENTER;
+    else
+    {
+      uint8_t s = (uint16_t)(angle + (1 << (_shift - 1))) >> _shift;
+
+      if (_sector == CENTER)
+        _sector = s;
+      else if (s != _sector)
+      {
+        // stay in the current sector while inside its extended band
+        int16_t d = angle - ((uint16_t)_sector << _shift);
+        uint16_t ad = (d < 0 ? -(int32_t)d : d);
+
+        if (ad >= (1 << (_shift - 1)) + _hyst)
+          _sector = s;
+      }
+    }
+
+    return(_sector);
+  }
+
+  /**
+   * Get the current direction.
+   *
+   * \return the sector number, or CENTER.
+   */
+  inline uint8_t get(void) const { return(_sector); }
+
+  private:
+  uint8_t  _sector;   ///< the current sector, or CENTER
+  uint8_t  _shift;    ///< log2 of the sector width in binary angle units
+  uint8_t  _hystDeg;  ///< the hysteresis band in degrees
+  uint16_t _hyst;     ///< the hysteresis band in binary angle units
+};
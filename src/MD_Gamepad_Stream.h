@@ -0,0 +1,287 @@
+/*
+MD_Gamepad - Library to encapsulate a Gamepad/Joystick Shield.
+
+See main header file for information.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \file
+ * \brief Binary state stream format for the MD_Gamepad library
+ *
+ * Encodes the gamepad state into compact binary frames for sending over a serial
+ * link, and decodes them. This file does not use the Arduino API, so the same code
+ * is used by the sketch to encode and by the host tools in extras/host to decode.
+ *
+ * Each frame is, before framing, in little endian byte order:
+ * | Bytes | Field | Notes |
+ * |-------|-------|-------|
+ * | 1 | seq   | sequence number, incremented for every frame |
+ * | 1 | flags | F_SW, F_X, F_Y for the fields present, F_FULL for a full frame |
+ * | 2 | time  | time the state was sampled, low 16 bits of millis() |
+ * | 2 | sw    | switch bitmap (getState()), if F_SW is set |
+ * | 2 | x     | X axis value, if F_X is set |
+ * | 2 | y     | Y axis value, if F_Y is set |
+ * | 1 | crc   | CRC-8 (polynomial 0x07) of all the previous bytes |
+ *
+ * Only the fields that changed since the last frame are sent (delta encoding).
+ * A full frame, with all the fields, is sent as a keepalive at least once every
+ * keepalive period, whether or not the fields are changing, so a receiver that
+ * missed frames or started late is back in step within one keepalive period.
+ *
+ * The frame is then COBS (Consistent Overhead Byte Stuffing) encoded, which
+ * removes all the 0x00 bytes, and followed by a 0x00 delimiter. A receiver can
+ * find the start of the next frame after any error by waiting for a 0x00 byte.
+ * The largest frame on the wire is FRAME_MAX bytes.
+ */
+
+/**
+ * Binary state stream encoder and decoder.
+ *
+ * The encoder holds the last state sent and one preallocated frame buffer, and
+ * does not use the heap.
+ */
+class MD_GamepadStream
+{
+  public:
+  /**
+   * Frame flag bits.
+   */
+  enum : uint8_t
+  {
+    F_SW   = 0x01,   ///< switch bitmap present
+    F_X    = 0x02,   ///< X axis value present
+    F_Y    = 0x04,   ///< Y axis value present
+    F_FULL = 0x08,   ///< full frame (keepalive), all fields present
+  };
+
+  static const uint8_t FRAME_RAW = 11;              ///< largest frame before COBS encoding
+  static const uint8_t FRAME_MAX = FRAME_RAW + 2;   ///< largest frame on the wire, with COBS overhead and delimiter
+
+  /**
+   * Decoded frame data.
+   */
+  struct frame_t
+  {
+    uint8_t  seq;    ///< sequence number
+    uint8_t  flags;  ///< the fields present in the frame
+    uint16_t time;   ///< time the state was sampled
+    uint16_t sw;     ///< switch bitmap
+    int16_t  x;      ///< X axis value
+    int16_t  y;      ///< Y axis value
+  };
+
+  /**
+   * Initialize the encoder.
+   *
+   * The first frame encoded is a full frame.
+   *
+   * \param keepalive the longest time in milliseconds between full frames, 0 for none.
+   */
+  void begin(uint16_t keepalive)
+  {
+    _keepalive = keepalive;
+    _seq = 0;
+    _len = 0;
+    _full = true;
+  }
+
+  /**
+   * Force the next frame to be a full frame.
+   */
+  inline void sendFull(void) { _full = true; }
+
+  /**
+   * Encode the state into a frame if it has changed or a keepalive is due.
+   *
+   * \param now the current time in milliseconds.
+   * \param sw  the switch bitmap.
+   * \param x   the X axis value.
+   * \param y   the Y axis value.
+   * \return the number of bytes to send from data(), 0 if there is nothing to send.
+   */
+  uint8_t encode(uint32_t now, uint16_t sw, int16_t x, int16_t y)
+  {
+    uint8_t raw[FRAME_RAW];
+    uint8_t flags = 0;
+    uint8_t n = 4;
+
+    if (sw != _last.sw) flags |= F_SW;
+    if (x != _last.x) flags |= F_X;
+    if (y != _last.y) flags |= F_Y;
+    if (_full || (_keepalive != 0 && (uint16_t)((uint16_t)now - _lastFull) >= _keepalive))
+      flags = F_FULL | F_SW | F_X | F_Y;
+
+    _len = 0;
+    if (flags == 0)
+      return(0);
+
+    _last.seq = _seq;
+    _last.flags = flags;
+    _last.time = now;
+    raw[0] = _seq++;
+    raw[1] = flags;
+    put16(&raw[2], _last.time);
+    if (flags & F_SW) { _last.sw = sw; put16(&raw[n], sw); n += 2; }
+    if (flags & F_X)  { _last.x = x;   put16(&raw[n], x);  n += 2; }
+    if (flags & F_Y)  { _last.y = y;   put16(&raw[n], y);  n += 2; }
+    raw[n] = crc8(raw, n);
+    n++;
+
+    _len = cobsEncode(raw, n, _buf);
+    _buf[_len++] = 0;
+    if (flags & F_FULL)
+    {
+      _lastFull = now;
+      _full = false;
+    }
+
+    return(_len);
+  }
+
+  /**
+   * Get the encoded frame.
+   *
+   * \return pointer to the frame encoded by the last call to encode().
+   */
+  inline const uint8_t *data(void) const { return(_buf); }
+
+  /**
+   * Get the length of the encoded frame.
+   *
+   * \return the number of bytes in the frame encoded by the last call to encode().
+   */
+  inline uint8_t length(void) const { return(_len); }
+
+  /**
+   * Decode a frame in place.
+   *
+   * Decodes a frame received without its 0x00 delimiter, checks it and applies the
+   * fields present to the frame data. Fields not present in the frame are left
+   * unchanged, so f always holds the latest value of every field.
+   *
+   * \param buf the received frame, overwritten by the decoded bytes.
+   * \param len the number of bytes received.
+   * \param f   the frame data to update.
+   * \return true if the frame was valid, false if it was corrupt.
+   */
+  static bool decode(uint8_t *buf, uint8_t len, frame_t &f)
+  {
+    uint8_t n = cobsDecode(buf, len);
+    uint8_t flags, size;
+
+    if (n < 5 || crc8(buf, n) != 0)
+      return(false);
+
+    flags = buf[1];
+    size = 5 + ((flags & F_SW) ? 2 : 0) + ((flags & F_X) ? 2 : 0) + ((flags & F_Y) ? 2 : 0);
+    if (n != size)
+      return(false);
+
+    n = 4;
+    f.seq = buf[0];
+    f.flags = flags;
+    f.time = get16(&buf[2]);
+    if (flags & F_SW) { f.sw = get16(&buf[n]); n += 2; }
+    if (flags & F_X)  { f.x = get16(&buf[n]);  n += 2; }
+    if (flags & F_Y)  { f.y = get16(&buf[n]);  n += 2; }
+
+    return(true);
+  }
+
+  /**
+   * Calculate a CRC-8 (polynomial 0x07, initial value 0).
+   *
+   * A block followed by its CRC has a CRC of 0.
+   *
+   * \param p   the data.
+   * \param len the number of bytes.
+   * \return the CRC.
+   */
+  static uint8_t crc8(const uint8_t *p, uint8_t len)
+  {
+    uint8_t crc = 0;
+
+    while (len--)
+    {
+      crc ^= *p++;
+      for (uint8_t i = 0; i < 8; i++)
+        crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+
+    return(crc);
+  }
+
+  /**
+   * COBS encode a block of up to 254 bytes.
+   *
+   * \param in  the data.
+   * \param len the number of bytes, up to 254.
+   * \param out the buffer for the encoded data, at least len + 1 bytes.
+   * \return the number of bytes encoded, without a delimiter.
+   */
+  static uint8_t cobsEncode(const uint8_t *in, uint8_t len, uint8_t *out)
+  {
+    uint8_t code = 1, ci = 0, o = 1;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+      if (in[i] == 0)
+      {
+        out[ci] = code;
+        ci = o++;
+        code = 1;
+      }
+      else
+      {
+        out[o++] = in[i];
+        code++;
+      }
+    }
+    out[ci] = code;
+
+    return(o);
+  }
+
+  /**
+   * COBS decode a block in place.
+   *
+   * \param buf the encoded data without the delimiter, overwritten by the decoded data.
+   * \param len the number of encoded bytes.
+   * \return the number of decoded bytes, 0 if the data is not valid COBS.
+   */
+  static uint8_t cobsDecode(uint8_t *buf, uint8_t len)
+  {
+    uint8_t i = 0, o = 0;
+
+    while (i < len)
+    {
+      uint8_t code = buf[i++];
+
+      if (code == 0 || code - 1 > len - i)
+        return(0);
+      for (uint8_t k = 1; k < code; k++)
+        buf[o++] = buf[i++];
+      if (code < 0xff && i < len)
+        buf[o++] = 0;
+    }
+
+    return(o);
+  }
+
+  private:
+  frame_t  _last;           ///< the state in the last frame sent
+  uint16_t _keepalive;      ///< keepalive time in milliseconds
+  uint16_t _lastFull;       ///< time the last full frame was sent
+  uint8_t  _seq;            ///< sequence number for the next frame
+  uint8_t  _len;            ///< length of the encoded frame
+  bool     _full;           ///< true to send a full frame next
+  uint8_t  _buf[FRAME_MAX]; ///< the encoded frame
+
+  // Little endian 16 bit field access
+  static inline void put16(uint8_t *p, uint16_t v) { p[0] = v & 0xff; p[1] = v >> 8; }
+  static inline uint16_t get16(const uint8_t *p) { return(p[0] | (p[1] << 8)); }
+};